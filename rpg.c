@@ -1,13 +1,99 @@
 #include "raylib.h"
+#include "rlgl.h"
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <direct.h>
+#define MakeCaptureDir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MakeCaptureDir(path) mkdir(path, 0755)
+#endif
 
 #define SCREEN_WIDTH 1000
 #define SCREEN_HEIGHT 700
-#define INVENTORY_SIZE 4
+#define INVENTORY_CAPACITY 512
+#define INVENTORY_VISIBLE_SLOTS 4
+#define INVENTORY_STAGE_ITEMS 4
+#define WORLD_WIDTH 8000
+#define WORLD_HEIGHT 6000
+#define WORLD_ENTITY_COUNT 3000
+#define TILE_SIZE 16
+#define CHUNK_TILES 32
+#define CHUNK_PIXELS (TILE_SIZE * CHUNK_TILES)
+#define CHUNK_CACHE_SLOTS 16
+#define MAP_TILES 1000
+#define MAP_MAX_TILES 8192
+#define MAP_FILE "assets/mundo.rmap"
+#define FONT_FILE "assets/fonts/font.ttf"
+#define FONT_CACHE_FILE "assets/fonts/font.sdfcache"
+#define SDF_BASE_SIZE 48
+#define FONT_MAX_GLYPHS 256
+#define FONT_MAX_ATLAS_SIZE 4096
+#define MAX_TEXT_COMMANDS 512
+#define TEXT_ARENA_SIZE 16384
+#define SDF_SOLID_TEXELS 4
+#define UI_MAX_COMMANDS 256
+#define UI_MAX_QUADS 4096
+#define UI_TEXT_ARENA_SIZE 4096
+#define MAX_FRAME_DELTA 0.1f
+#define IDLE_POLL_INTERVAL (1.0 / 60.0)
+#define IDLE_REFRESH_SECONDS 1.0
+#define MAX_VISIBLE_ENTITIES 512
+#define MAX_TILE_EDITS 32
+#define LATENCY_BUCKET_MS 2
+#define LATENCY_BUCKETS 50
+#define LATENCY_LOG_FILE "latency_log.csv"
+#define CAPTURE_DIR "capturas"
+#define CAPTURE_PBO_COUNT 3
+#define CAPTURE_POOL_FRAMES 8
+
+// Buffer-object entry points raylib does not wrap, loaded through the GLFW it links in
+#ifndef APIENTRY
+#ifdef _WIN32
+#define APIENTRY __stdcall
+#else
+#define APIENTRY
+#endif
+#endif
+#ifndef RL_DEFAULT_BATCH_BUFFER_ELEMENTS
+#define RL_DEFAULT_BATCH_BUFFER_ELEMENTS 8192
+#endif
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_READ_ONLY 0x88B8
+#define GL_RGBA 0x1908
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_CONDITION_SATISFIED 0x911C
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+
+typedef void (*GlfwProc)(void);
+extern GlfwProc glfwGetProcAddress(const char *procname);
+extern void glfwPostEmptyEvent(void);
+typedef void(APIENTRY *GlGenBuffersProc)(int n, unsigned int *buffers);
+typedef void(APIENTRY *GlDeleteBuffersProc)(int n, const unsigned int *buffers);
+typedef void(APIENTRY *GlBindBufferProc)(unsigned int target, unsigned int buffer);
+typedef void(APIENTRY *GlBufferDataProc)(unsigned int target, ptrdiff_t size, const void *data, unsigned int usage);
+typedef void(APIENTRY *GlReadPixelsProc)(int x, int y, int width, int height, unsigned int format, unsigned int type, void *pixels);
+typedef void *(APIENTRY *GlMapBufferProc)(unsigned int target, unsigned int access);
+typedef unsigned char(APIENTRY *GlUnmapBufferProc)(unsigned int target);
+typedef void *(APIENTRY *GlFenceSyncProc)(unsigned int condition, unsigned int flags);
+typedef unsigned int(APIENTRY *GlClientWaitSyncProc)(void *sync, unsigned int flags, unsigned long long timeout);
+typedef void(APIENTRY *GlDeleteSyncProc)(void *sync);
+typedef void(APIENTRY *GlTexParameteriProc)(unsigned int target, unsigned int pname, int param);
+#define SPATIAL_CELL_SIZE 256.0f
+#define MAX_QUERY_RESULTS 1024
 
 typedef enum
 {
@@ -35,6 +121,144 @@ typedef enum
     BATTLE_BOSS_TURN
 } BattleState;
 
+typedef enum
+{
+    MEM_TAG_ASSETS,
+    MEM_TAG_TEXT,
+    MEM_TAG_RENDERING,
+    MEM_TAG_WORLD,
+    MEM_TAG_CAPTURE,
+    MEM_TAG_COUNT
+} MemoryTag;
+
+typedef struct
+{
+    long heapBytes;
+    long peakHeapBytes;
+    long textureBytes;
+    long peakTextureBytes;
+    int allocations;
+    int textures;
+} MemoryStats;
+
+typedef enum
+{
+    ENTITY_DOOR,
+    ENTITY_PICKUP,
+    ENTITY_NPC
+} EntityType;
+
+typedef struct
+{
+    EntityType type;
+    Rectangle rect;
+    bool active;
+    int choice;
+    int line;
+    Vector2 velocity;
+    float wanderTimer;
+    int cell;
+    int prevInCell;
+    int nextInCell;
+} WorldEntity;
+
+// Uniform grid; every entity is linked into the cell holding its center, so moving one is O(1)
+typedef struct
+{
+    float cellSize;
+    int cols;
+    int rows;
+    float maxHalfExtent;
+    int *cellHeads;
+} SpatialHash;
+
+typedef enum
+{
+    TILE_EMPTY,
+    TILE_WATER,
+    TILE_SAND,
+    TILE_GRASS,
+    TILE_FOREST,
+    TILE_STONE,
+    TILE_PATH,
+    TILE_TYPE_COUNT
+} TileType;
+
+typedef struct
+{
+    unsigned char *tiles;
+    int cacheSlot;
+    bool dirty;
+} MapChunk;
+
+typedef struct
+{
+    RenderTexture2D target;
+    int chunk;
+    unsigned int lastUsed;
+} ChunkCacheSlot;
+
+// Tiles live on disk as RLE-compressed chunks behind an offset table and are streamed in on first view
+typedef struct
+{
+    FILE *file;
+    int widthTiles;
+    int heightTiles;
+    int chunkCols;
+    int chunkRows;
+    unsigned int *chunkOffsets;
+    MapChunk *chunks;
+    ChunkCacheSlot cache[CHUNK_CACHE_SLOTS];
+    unsigned int frame;
+    int chunksDrawn;
+    int chunksRebuilt;
+    int chunksStreamed;
+} TileMap;
+
+typedef struct
+{
+    int offset;
+    Vector2 position;
+    float size;
+    Color color;
+} TextCommand;
+
+typedef enum
+{
+    UI_RECT,
+    UI_TEXT
+} UiCommandType;
+
+typedef struct
+{
+    UiCommandType type;
+    Rectangle rect;
+    Color color;
+    int textOffset;
+    int fontSize;
+} UiCommand;
+
+typedef struct
+{
+    Rectangle dest;
+    Rectangle source;
+    Color color;
+} UiQuad;
+
+// Commands are rebuilt only when the layout key changes; with the SDF atlas they resolve to one list of
+// textured quads (rects sample a solid block of the atlas) that is submitted as a single draw call
+typedef struct
+{
+    unsigned long long key;
+    bool valid;
+    UiCommand commands[UI_MAX_COMMANDS];
+    int commandCount;
+    char text[UI_TEXT_ARENA_SIZE];
+    int textUsed;
+    UiQuad quads[UI_MAX_QUADS];
+    int quadCount;
+} UiLayer;
+
 typedef struct
 {
     int hp;
@@ -48,15 +272,102 @@ typedef struct
     int attack;
 } Boss;
 
+typedef enum
+{
+    GAME_KEY_LEFT,
+    GAME_KEY_RIGHT,
+    GAME_KEY_UP,
+    GAME_KEY_DOWN,
+    GAME_KEY_A,
+    GAME_KEY_D,
+    GAME_KEY_W,
+    GAME_KEY_S,
+    GAME_KEY_ENTER,
+    GAME_KEY_COUNT
+} GameKey;
+
+// Keyboard state sampled on the main thread, consumed by exactly one simulation step
+typedef struct
+{
+    unsigned int pressed;
+    unsigned int down;
+    double time;
+    unsigned int sequence;
+} InputFrame;
+
+typedef struct
+{
+    EntityType type;
+    Rectangle rect;
+    int choice;
+} VisibleEntity;
+
+typedef struct
+{
+    int x;
+    int y;
+    unsigned char tile;
+} TileEdit;
+
+// Everything the Draw* functions read; the simulation fills one while the renderer draws the other
+typedef struct
+{
+    GameState state;
+    int stage;
+    Player player;
+    Boss boss;
+    ItemType inventory[INVENTORY_CAPACITY];
+    bool itemUsed[INVENTORY_CAPACITY];
+    int inventoryCount;
+    int inventoryScroll;
+    unsigned int inventoryVersion;
+    int selectedItemIndex;
+    char battleMessage[256];
+    ItemType lastItemCollected;
+    float itemMessageTimer;
+
+    bool playerIsAttacking;
+    float playerAttackTimer;
+    int playerAttackFrame;
+    float playerHurtTimer;
+    bool bossIsAttacking;
+    float bossAttackTimer;
+    int bossAttackFrame;
+    float bossHurtTimer;
+
+    Vector2 explorePlayer;
+    Camera2D camera;
+    int gemsCollected;
+    const char *exploreNotice;
+    const char *npcLine;
+    Rectangle npcRect;
+    VisibleEntity visible[MAX_VISIBLE_ENTITIES];
+    int visibleCount;
+    TileEdit tileEdits[MAX_TILE_EDITS];
+    int tileEditCount;
+
+    int titlePhase;
+    bool dirty;
+    double wakeDelay;
+    double inputTime;
+    double simSeconds;
+    const char *reflectedAction;
+    double reflectedInputTime;
+    unsigned int reflectedSequence;
+} FrameSnapshot;
+
 static GameState currentState;
 static BattleState battleState;
 
 static Player player;
 static Boss boss;
 
-static ItemType inventory[INVENTORY_SIZE];
-static bool itemUsed[INVENTORY_SIZE];
+static ItemType inventory[INVENTORY_CAPACITY];
+static bool itemUsed[INVENTORY_CAPACITY];
 static int inventoryCount;
+static int inventoryScroll;
+static unsigned int inventoryVersion;
+static bool debugInventory = false;
 static int selectedItemIndex;
 static int currentStage;
 
@@ -95,6 +406,134 @@ static Texture2D bgStage1;
 static Texture2D bgStage2;
 static Texture2D bgStage3;
 static Texture2D bgStage4;
+static Texture2D tilesetTexture;
+
+static TileMap tileMap;
+
+static Font sdfFont;
+static Shader sdfShader;
+static bool sdfFontReady = false;
+static bool useLegacyText = false;
+static TextCommand textCommands[MAX_TEXT_COMMANDS];
+static int textCommandCount;
+static char textArena[TEXT_ARENA_SIZE];
+static int textArenaUsed;
+static double textFrameTime;
+static double textAverageMs;
+static int textFrameCalls;
+static double fontStartupMs;
+static bool fontFromCache;
+static Rectangle sdfSolidRect;
+
+static UiLayer battleHud;
+static bool useLegacyHud = false;
+static int hudDrawCalls;
+static int hudPrimitives;
+static int hudLastBatchKind = -1;
+static double hudCpuAverage;
+static long hudFrames;
+static long hudCacheHits;
+
+static float frameDelta;
+static bool frameDirty = true;
+static bool idlePacing = true;
+static int lastTitlePhase = -1;
+static bool battleWasAnimating;
+static long framesDrawn;
+static InputFrame simInput;
+static GameState lastCapturedState = GAME_STATE_TITLE;
+static TileEdit pendingTileEdits[MAX_TILE_EDITS];
+static int pendingTileEditCount;
+static const int gameKeyCodes[GAME_KEY_COUNT] = {KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN, KEY_A, KEY_D, KEY_W, KEY_S, KEY_ENTER};
+
+static FrameSnapshot snapshots[2];
+static bool pipelined = true;
+static bool uncapped = false;
+static pthread_t simThread;
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t simCond = PTHREAD_COND_INITIALIZER;
+static bool simJobPending;
+static bool simJobDone = true;
+static bool simQuit;
+static InputFrame simJobInput;
+static float simJobDelta;
+static int simJobTarget;
+static pthread_t idleWakerThread;
+static pthread_mutex_t idleWakerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idleWakerCond = PTHREAD_COND_INITIALIZER;
+static struct timespec idleWakeAt;
+static bool idleWakerArmed;
+static bool idleWakerRunning;
+static bool idleWakerQuit;
+static double simTimeAverage;
+static double drawTimeAverage;
+static double latencyAverage;
+static unsigned int inputSequence;
+static const char *reflectedAction;
+static int latencyHistogram[LATENCY_BUCKETS];
+static int latencySamples;
+static double latencyLastMs;
+static double latencyMaxMs;
+static FILE *latencyLog;
+
+static bool captureActive;
+static int captureWidth;
+static int captureHeight;
+static char captureDir[64];
+static unsigned int capturePbos[CAPTURE_PBO_COUNT];
+static void *captureFences[CAPTURE_PBO_COUNT];
+static long capturePboFrame[CAPTURE_PBO_COUNT];
+static int captureNextPbo;
+static unsigned char *capturePool[CAPTURE_POOL_FRAMES];
+static long capturePoolFrame[CAPTURE_POOL_FRAMES];
+static int captureFreeList[CAPTURE_POOL_FRAMES];
+static int captureFreeCount;
+static int captureQueue[CAPTURE_POOL_FRAMES];
+static int captureQueueHead;
+static int captureQueueCount;
+static unsigned char *captureScratchRow;
+static pthread_t captureThread;
+static pthread_mutex_t captureMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t captureCond = PTHREAD_COND_INITIALIZER;
+static bool captureStopping;
+static long captureFramesWritten;
+static long captureFramesDropped;
+static double captureStartTime;
+static double captureCostAverage;
+
+static GlGenBuffersProc glGenBuffersFn;
+static GlDeleteBuffersProc glDeleteBuffersFn;
+static GlBindBufferProc glBindBufferFn;
+static GlBufferDataProc glBufferDataFn;
+static GlReadPixelsProc glReadPixelsFn;
+static GlMapBufferProc glMapBufferFn;
+static GlUnmapBufferProc glUnmapBufferFn;
+static GlFenceSyncProc glFenceSyncFn;
+static GlClientWaitSyncProc glClientWaitSyncFn;
+static GlDeleteSyncProc glDeleteSyncFn;
+static long framesSkipped;
+static double drawnFrameCpuAverage;
+static double cpuTimeSaved;
+
+// Same smoothstep over the distance field as raylib's text_font_sdf example. The width is clamped
+// because the solid HUD block has a flat field, and smoothstep is undefined when both edges meet.
+static const char *sdfFragmentShader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float dist = texture(texture0, fragTexCoord).a - 0.5;\n"
+    "    float width = max(length(vec2(dFdx(dist), dFdy(dist))), 1e-4);\n"
+    "    float alpha = smoothstep(-width, width, dist);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+    "}\n";
+static const Color tileColors[TILE_TYPE_COUNT] = {
+    {0, 0, 0, 0}, {40, 90, 170, 255}, {200, 180, 120, 255}, {70, 140, 60, 255},
+    {35, 95, 45, 255}, {120, 120, 125, 255}, {150, 120, 80, 255}};
+static const Color stageTints[4] = {{255, 255, 255, 255}, {225, 215, 255, 255}, {205, 230, 205, 255}, {255, 205, 195, 255}};
 
 static bool texturesInitialized = false;
 
@@ -110,16 +549,38 @@ static float bossAttackFrameDuration;
 
 static float explorePlayerX;
 static float explorePlayerY;
-static Rectangle doorLeftRect;
-static Rectangle doorRightRect;
 static float explorePlayerSpeed;
+static Camera2D exploreCamera;
+static float worldWidth;
+static float worldHeight;
+static WorldEntity *worldEntities;
+static int worldEntityCount;
+static SpatialHash worldHash;
+static unsigned int worldRngState = 2463534242u;
+static int queryResults[MAX_QUERY_RESULTS];
+static int nearbyNpc = -1;
+static int gemsCollected;
+static const char *exploreNotice;
+static float exploreNoticeTimer;
+
+static const char *npcLines[] = {
+    "Dizem que a espada antiga corta pedra.",
+    "Já vi muitos heróis entrarem. Nenhum voltou.",
+    "O chefe odeia moedas... ou será que ama?",
+    "Guarde a bomba para o final da luta.",
+    "As portas marrons estão trancadas há anos."};
+
+static MemoryStats memoryStats[MEM_TAG_COUNT];
+static long peakTotalBytes;
+static bool showMemoryOverlay = false;
+static const char *memoryTagNames[MEM_TAG_COUNT] = {"assets", "text", "rendering", "world", "capture"};
 
 const char *GetItemName(ItemType item)
 {
     switch (item)
     {
     case ITEM_POTION:
-        return "Pocao (Cura 50 HP)";
+        return "Poção (Cura 50 HP)";
     case ITEM_SWORD:
         return "Espada (Dano 30)";
     case ITEM_BOMB:
@@ -144,6 +605,56 @@ ItemType GetItemForChoice(int stage, int choice)
     return ITEM_POTION;
 }
 
+InputFrame PollInputFrame(void)
+{
+    InputFrame frame = {0};
+    for (int i = 0; i < GAME_KEY_COUNT; i++)
+    {
+        if (IsKeyPressed(gameKeyCodes[i]))
+            frame.pressed |= 1u << i;
+        if (IsKeyDown(gameKeyCodes[i]))
+            frame.down |= 1u << i;
+    }
+    // Polls happen at the end of EndDrawing or when an idle wait wakes on an event, so this bounds the arrival time
+    frame.time = GetTime();
+    if (frame.pressed)
+        frame.sequence = ++inputSequence;
+    return frame;
+}
+
+unsigned int GameKeyBit(int key)
+{
+    for (int i = 0; i < GAME_KEY_COUNT; i++)
+    {
+        if (gameKeyCodes[i] == key)
+            return 1u << i;
+    }
+    return 0;
+}
+
+bool InputPressed(int key)
+{
+    return (simInput.pressed & GameKeyBit(key)) != 0;
+}
+
+bool InputDown(int key)
+{
+    return (simInput.down & GameKeyBit(key)) != 0;
+}
+
+void MarkDirty(void)
+{
+    frameDirty = true;
+}
+
+// Tags the snapshot being built as the first one showing the result of this frame's key press
+void ReflectInput(const char *action)
+{
+    MarkDirty();
+    if (simInput.pressed && reflectedAction == NULL)
+        reflectedAction = action;
+}
+
 void BossAttack()
 {
     bossIsAttacking = true;
@@ -171,19 +682,54 @@ void BossAttack()
         player.hp = 0;
 
     if (playerHasArmor)
-        sprintf(messageBuffer, "Chefe ataca com armadura ativa! Voce levou %d de dano.", damage);
+        sprintf(messageBuffer, "Chefe ataca com armadura ativa! Você levou %d de dano.", damage);
     else
-        sprintf(messageBuffer, "Chefe ataca! Voce levou %d de dano!", damage);
+        sprintf(messageBuffer, "Chefe ataca! Você levou %d de dano!", damage);
 
     battleMessage = messageBuffer;
     playerHurtTimer = PLAYER_HURT_DURATION;
 }
 
+bool AddInventoryItem(ItemType item)
+{
+    if (inventoryCount >= INVENTORY_CAPACITY)
+        return false;
+    inventory[inventoryCount] = item;
+    itemUsed[inventoryCount] = false;
+    inventoryCount++;
+    inventoryVersion++;
+    return true;
+}
+
+// --debug-inventory: fills the bar with consumables to exercise paging, leaving room for the stage picks
+void FillDebugInventory(void)
+{
+    const ItemType items[] = {ITEM_POTION, ITEM_BOMB, ITEM_COIN};
+    while (inventoryCount < INVENTORY_CAPACITY - INVENTORY_STAGE_ITEMS)
+        AddInventoryItem(items[inventoryCount % 3]);
+}
+
+// Empty slots keep the bar at its original width until the inventory outgrows it
+int InventorySlotCount(void)
+{
+    return (inventoryCount > INVENTORY_VISIBLE_SLOTS) ? inventoryCount : INVENTORY_VISIBLE_SLOTS;
+}
+
+void SelectInventorySlot(int index)
+{
+    selectedItemIndex = index;
+    if (selectedItemIndex < inventoryScroll)
+        inventoryScroll = selectedItemIndex;
+    else if (selectedItemIndex >= inventoryScroll + INVENTORY_VISIBLE_SLOTS)
+        inventoryScroll = selectedItemIndex - INVENTORY_VISIBLE_SLOTS + 1;
+}
+
 void UseItem(int index)
 {
+    inventoryVersion++;
     if (itemUsed[index])
     {
-        battleMessage = "Este item ja foi usado!";
+        battleMessage = "Este item já foi usado!";
         return;
     }
 
@@ -194,7 +740,7 @@ void UseItem(int index)
         player.hp += 50;
         if (player.hp > player.maxHp)
             player.hp = player.maxHp;
-        battleMessage = "Voce usou Pocao! Curou 50 HP!";
+        battleMessage = "Você usou Poção! Curou 50 HP!";
         itemUsed[index] = true;
         break;
     case ITEM_SWORD:
@@ -204,7 +750,7 @@ void UseItem(int index)
     {
         int dmg = 60 + (rand() % 31);
         boss.hp -= dmg;
-        sprintf(messageBuffer, "Voce usou Bomba! Causou %d de dano!", dmg);
+        sprintf(messageBuffer, "Você usou Bomba! Causou %d de dano!", dmg);
         battleMessage = messageBuffer;
         itemUsed[index] = true;
         break;
@@ -213,23 +759,23 @@ void UseItem(int index)
         itemUsed[index] = true;
         if (rand() % 2 == 0)
         {
-            battleMessage = "Voce usou Moeda! Distraiu o chefe e fugiu!";
+            battleMessage = "Você usou Moeda! Distraiu o chefe e fugiu!";
             currentState = GAME_STATE_ENDING_ESCAPE;
             return;
         }
         else
         {
-            battleMessage = "Voce usou Moeda! Mas o chefe nao se distraiu...";
+            battleMessage = "Você usou Moeda! Mas o chefe não se distraiu...";
             battleState = BATTLE_BOSS_TURN;
             bossTurnTimer = 1.5f;
             return;
         }
     case ITEM_ARMOR:
         playerHasArmor = true;
-        battleMessage = "Voce equipou Armadura! Proximos ataques causarao menos dano.";
+        battleMessage = "Você equipou Armadura! Próximos ataques causarão menos dano.";
         break;
     default:
-        battleMessage = "Item invalido?";
+        battleMessage = "Item inválido?";
         break;
     }
 
@@ -241,7 +787,7 @@ void UseItem(int index)
 
 bool PlayerHasSword(void)
 {
-    for (int i = 0; i < INVENTORY_SIZE; i++)
+    for (int i = 0; i < inventoryCount; i++)
     {
         if (inventory[i] == ITEM_SWORD)
             return true;
@@ -255,12 +801,12 @@ void PlayerAttack(void)
     if (PlayerHasSword())
     {
         damage = 20 + (rand() % 21);
-        sprintf(messageBuffer, "Voce atacou com a espada! Causou %d de dano!", damage);
+        sprintf(messageBuffer, "Você atacou com a espada! Causou %d de dano!", damage);
     }
     else
     {
         damage = 15 + (rand() % 8);
-        sprintf(messageBuffer, "Voce atacou desarmado! Causou %d de dano!", damage);
+        sprintf(messageBuffer, "Você atacou desarmado! Causou %d de dano!", damage);
     }
     boss.hp -= damage;
     if (boss.hp < 0)
@@ -277,233 +823,1918 @@ void PlayerAttack(void)
     bossTurnTimer = 1.1f;
 }
 
-Texture2D LoadAsset(const char *baseName)
+int TextureByteSize(Texture2D texture)
 {
-    char path[128];
-    sprintf(path, "assets/%s.png", baseName);
-    if (FileExists(path))
-        return LoadTexture(path);
-
-    sprintf(path, "assets/%s.jpg", baseName);
-    if (FileExists(path))
-        return LoadTexture(path);
-
-    sprintf(path, "assets/%s.bmp", baseName);
-    if (FileExists(path))
-        return LoadTexture(path);
+    int bytes = 0;
+    int w = texture.width;
+    int h = texture.height;
+    int levels = (texture.mipmaps > 0) ? texture.mipmaps : 1;
+    for (int i = 0; i < levels; i++)
+    {
+        bytes += GetPixelDataSize(w, h, texture.format);
+        w = (w > 1) ? w / 2 : 1;
+        h = (h > 1) ? h / 2 : 1;
+    }
+    return bytes;
+}
 
-    return (Texture2D){0};
+long MemoryTotalBytes(void)
+{
+    long total = 0;
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+        total += memoryStats[i].heapBytes + memoryStats[i].textureBytes;
+    return total;
 }
 
-void InitGame(void)
+void UpdateMemoryPeaks(MemoryTag tag)
 {
-    currentState = GAME_STATE_TITLE;
-    currentStage = 0;
-    inventoryCount = 0;
-    itemMessageTimer = 0.0f;
-    lastItemCollected = ITEM_NONE;
+    MemoryStats *stats = &memoryStats[tag];
+    if (stats->heapBytes > stats->peakHeapBytes)
+        stats->peakHeapBytes = stats->heapBytes;
+    if (stats->textureBytes > stats->peakTextureBytes)
+        stats->peakTextureBytes = stats->textureBytes;
+
+    long total = MemoryTotalBytes();
+    if (total > peakTotalBytes)
+        peakTotalBytes = total;
+}
 
-    for (int i = 0; i < INVENTORY_SIZE; i++)
+// Every tracked block is preceded by a header holding its size and tag, so TrackedFree needs only the pointer
+typedef union
+{
+    struct
     {
-        inventory[i] = ITEM_NONE;
-        itemUsed[i] = false;
-    }
+        size_t size;
+        MemoryTag tag;
+    } info;
+    max_align_t align;
+} AllocHeader;
 
-    player.hp = 120;
-    player.maxHp = 120;
-    boss.hp = 210;
-    boss.maxHp = 210;
-    boss.attack = 22;
+void *TrackedAlloc(MemoryTag tag, size_t size)
+{
+    AllocHeader *header = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+    if (header == NULL)
+        return NULL;
+
+    header->info.size = size;
+    header->info.tag = tag;
+    memoryStats[tag].heapBytes += (long)size;
+    memoryStats[tag].allocations++;
+    UpdateMemoryPeaks(tag);
+    return header + 1;
+}
 
-    battleState = BATTLE_PLAYER_TURN;
-    selectedItemIndex = 0;
-    playerHasArmor = false;
-    battleMessage = "Batalha contra o Chefe! Escolha seu item.";
+void *TrackedCalloc(MemoryTag tag, size_t count, size_t size)
+{
+    void *ptr = TrackedAlloc(tag, count * size);
+    if (ptr != NULL)
+        memset(ptr, 0, count * size);
+    return ptr;
+}
 
-    srand((unsigned int)time(NULL));
+void TrackedFree(void *ptr)
+{
+    if (ptr == NULL)
+        return;
 
-    explorePlayerX = SCREEN_WIDTH / 2 - 10;
-    explorePlayerY = 420;
-    explorePlayerSpeed = 250.0f;
-    doorLeftRect = (Rectangle){100, 240, 150, 220};
-    doorRightRect = (Rectangle){SCREEN_WIDTH - 250, 240, 150, 220};
+    AllocHeader *header = (AllocHeader *)ptr - 1;
+    memoryStats[header->info.tag].heapBytes -= (long)header->info.size;
+    memoryStats[header->info.tag].allocations--;
+    free(header);
+}
 
-    if (!texturesInitialized)
-    {
-        playerTexture = LoadAsset("boss_player/player");
-        bossTexture = LoadAsset("boss_player/boss");
-        titleBackgroundTexture = LoadAsset("cenarios/title_bg");
-        battleBackgroundTexture = LoadAsset("cenarios/battle_bg");
-        escapeEndingBackgroud = LoadAsset("cenarios/escapeEnding");
-        wonEndingBackgroud = LoadAsset("cenarios/wonEnding");
-        loseEndingBackgroud = LoadAsset("cenarios/loseEnding");
+void TrackTextureBytes(MemoryTag tag, long bytes)
+{
+    memoryStats[tag].textureBytes += bytes;
+    memoryStats[tag].textures += (bytes >= 0) ? 1 : -1;
+    UpdateMemoryPeaks(tag);
+}
 
-        bgStage1 = LoadAsset("cenarios/cenario1");
-        bgStage2 = LoadAsset("cenarios/cenario2");
-        bgStage3 = LoadAsset("cenarios/cenario3");
-        bgStage4 = LoadAsset("cenarios/cenario4");
+Texture2D TrackTexture(MemoryTag tag, Texture2D texture)
+{
+    if (texture.id != 0)
+        TrackTextureBytes(tag, TextureByteSize(texture));
+    return texture;
+}
 
-        bossAttackTexture = LoadAsset("boss_attack");
-        playerHitTexture = LoadAsset("player_hit");
-        bossHitTexture = LoadAsset("boss_hit");
-        playerAttackTexture = LoadAsset("player_attack");
+// LoadRenderTexture also attaches a depth renderbuffer; drivers store its 24-bit depth in 32 bits
+long RenderTargetDepthBytes(RenderTexture2D target)
+{
+    return (target.depth.id != 0) ? (long)target.depth.width * target.depth.height * 4 : 0;
+}
 
-        bossAttackFrameCount = 1;
-        bossAttackFrameDuration = BOSS_ATTACK_DURATION;
-        if (bossAttackTexture.id != 0 && bossAttackTexture.height > 0)
-        {
-            bossAttackFrameCount = bossAttackTexture.width / bossAttackTexture.height;
-            if (bossAttackFrameCount < 1)
-                bossAttackFrameCount = 1;
-            bossAttackFrameDuration = BOSS_ATTACK_DURATION / (float)bossAttackFrameCount;
-        }
+void UnloadTrackedTexture(MemoryTag tag, Texture2D *texture)
+{
+    if (texture->id == 0)
+        return;
 
-        playerAttackFrameCount = 1;
-        playerAttackFrameDuration = PLAYER_ATTACK_DURATION;
-        if (playerAttackTexture.id != 0 && playerAttackTexture.height > 0)
-        {
-            playerAttackFrameCount = playerAttackTexture.width / playerAttackTexture.height;
-            if (playerAttackFrameCount < 1)
-                playerAttackFrameCount = 1;
-            playerAttackFrameDuration = PLAYER_ATTACK_DURATION / (float)playerAttackFrameCount;
-        }
+    TrackTextureBytes(tag, -TextureByteSize(*texture));
+    UnloadTexture(*texture);
+    *texture = (Texture2D){0};
+}
 
-        texturesInitialized = true;
-    }
+bool SaveMemoryReport(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
 
-    bossIsAttacking = false;
-    bossAttackTimer = 0.0f;
-    bossHurtTimer = 0.0f;
+    fprintf(file, "{\n  \"subsystems\": {\n");
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        MemoryStats *stats = &memoryStats[i];
+        fprintf(file, "    \"%s\": {\"heap_bytes\": %ld, \"peak_heap_bytes\": %ld, \"allocations\": %d, "
+                      "\"texture_bytes\": %ld, \"peak_texture_bytes\": %ld, \"textures\": %d}%s\n",
+                memoryTagNames[i], stats->heapBytes, stats->peakHeapBytes, stats->allocations,
+                stats->textureBytes, stats->peakTextureBytes, stats->textures, (i < MEM_TAG_COUNT - 1) ? "," : "");
+    }
+    fprintf(file, "  },\n  \"total_bytes\": %ld,\n  \"peak_total_bytes\": %ld\n}\n", MemoryTotalBytes(), peakTotalBytes);
+    fclose(file);
+    return true;
 }
 
-void UpdateExplore(void)
+// Run after teardown: whatever is still counted was never released through the tracked path
+int CheckMemoryLeaks(void)
 {
-    if (itemMessageTimer > 0)
+    int leaks = 0;
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
     {
-        itemMessageTimer -= GetFrameTime();
-        if (itemMessageTimer <= 0 && currentStage >= 4)
-        {
-            currentState = GAME_STATE_BATTLE;
-            battleState = BATTLE_PLAYER_TURN;
-        }
-        return;
+        MemoryStats *stats = &memoryStats[i];
+        if (stats->heapBytes == 0 && stats->allocations == 0 && stats->textureBytes == 0 && stats->textures == 0)
+            continue;
+        TraceLog(LOG_WARNING, "MEMORY: vazamento em %s: %ld bytes em %d alocacoes, %ld bytes em %d texturas", memoryTagNames[i],
+                 stats->heapBytes, stats->allocations, stats->textureBytes, stats->textures);
+        leaks++;
     }
+    return leaks;
+}
 
-    float delta = GetFrameTime();
-    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
-        explorePlayerX += explorePlayerSpeed * delta;
-    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
-        explorePlayerX -= explorePlayerSpeed * delta;
-
-    if (explorePlayerX < 60)
-        explorePlayerX = 60;
-    if (explorePlayerX > SCREEN_WIDTH - 80)
-        explorePlayerX = SCREEN_WIDTH - 80;
-
-    if (IsKeyPressed(KEY_ENTER))
+int *FontCodepoints(int *count)
+{
+    static int codepoints[FONT_MAX_GLYPHS];
+    const char *extra = "áàâãéêíóôõúüçÁÀÂÃÉÊÍÓÔÕÚÜÇªº°";
+    int n = 0;
+    for (int c = 32; c < 127; c++)
+        codepoints[n++] = c;
+    for (const char *p = extra; *p;)
     {
-        Rectangle playerRect = (Rectangle){explorePlayerX - 5, explorePlayerY - 10, 30, 60};
-        int chosen = -1;
-        if (CheckCollisionRecs(playerRect, doorLeftRect))
-            chosen = 0;
-        if (CheckCollisionRecs(playerRect, doorRightRect))
-            chosen = 1;
-
-        if (chosen != -1)
-        {
-            lastItemCollected = GetItemForChoice(currentStage, chosen);
-            if (inventoryCount < INVENTORY_SIZE)
-            {
-                inventory[inventoryCount] = lastItemCollected;
-                inventoryCount++;
-            }
-            currentStage++;
-            itemMessageTimer = 2.0f;
-            explorePlayerX = SCREEN_WIDTH / 2 - 10;
-        }
+        int size = 0;
+        codepoints[n++] = GetCodepointNext(p, &size);
+        p += size;
     }
+    *count = n;
+    return codepoints;
 }
 
-void UpdateBattle(void)
+// Appends an opaque block under the glyphs so UI rectangles can be drawn from the same texture and shader
+void AddSolidAtlasBlock(Image *atlas)
 {
-    float delta = GetFrameTime();
+    ImageResizeCanvas(atlas, atlas->width, atlas->height + SDF_SOLID_TEXELS, 0, 0, BLANK);
+    ImageDrawRectangle(atlas, 0, atlas->height - SDF_SOLID_TEXELS, SDF_SOLID_TEXELS, SDF_SOLID_TEXELS, WHITE);
+}
 
-    if (playerIsAttacking)
+bool SaveFontCache(const char *path, Font font, Image atlas, long sourceModTime)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    int header[7] = {2, font.baseSize, font.glyphCount, font.glyphPadding, atlas.width, atlas.height, atlas.format};
+    fwrite("SDFC", 1, 4, file);
+    fwrite(&sourceModTime, sizeof(sourceModTime), 1, file);
+    fwrite(header, sizeof(header), 1, file);
+    for (int i = 0; i < font.glyphCount; i++)
     {
-        playerAttackTimer -= delta;
-        if (playerAttackTimer <= 0.0f)
-            playerIsAttacking = false;
-
-        if (playerAttackFrameCount > 1)
-        {
-            playerAttackFrameTime += delta;
-            if (playerAttackFrameTime >= playerAttackFrameDuration)
-            {
-                playerAttackFrameTime -= playerAttackFrameDuration;
-                playerAttackFrame = (playerAttackFrame + 1) % playerAttackFrameCount;
-            }
-        }
+        int metrics[4] = {font.glyphs[i].value, font.glyphs[i].offsetX, font.glyphs[i].offsetY, font.glyphs[i].advanceX};
+        fwrite(metrics, sizeof(metrics), 1, file);
+        fwrite(&font.recs[i], sizeof(Rectangle), 1, file);
     }
+    fwrite(atlas.data, 1, (size_t)GetPixelDataSize(atlas.width, atlas.height, atlas.format), file);
+    fclose(file);
+    return true;
+}
 
-    if (bossIsAttacking)
+bool LoadFontCache(const char *path, long sourceModTime, Font *font)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    char magic[4];
+    long modTime = 0;
+    int header[7];
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, "SDFC", 4) != 0 ||
+        fread(&modTime, sizeof(modTime), 1, file) != 1 || modTime != sourceModTime ||
+        fread(header, sizeof(header), 1, file) != 1 || header[0] != 2 || header[1] != SDF_BASE_SIZE)
     {
-        bossAttackTimer -= delta;
-        if (bossAttackTimer <= 0.0f)
-            bossIsAttacking = false;
-
-        if (bossAttackFrameCount > 1)
-        {
-            bossAttackFrameTime += delta;
-            if (bossAttackFrameTime >= bossAttackFrameDuration)
-            {
-                bossAttackFrameTime -= bossAttackFrameDuration;
-                bossAttackFrame = (bossAttackFrame + 1) % bossAttackFrameCount;
-            }
-        }
+        fclose(file);
+        return false;
     }
 
-    if (bossHurtTimer > 0.0f)
-        bossHurtTimer -= delta;
-    if (playerHurtTimer > 0.0f)
-        playerHurtTimer -= delta;
-
-    if (boss.hp <= 0)
-    {
-        currentState = GAME_STATE_ENDING_GOOD;
-        return;
-    }
-    if (player.hp <= 0)
+    // The cache sits in a user-writable folder: bound every size before it reaches an allocation,
+    // any mismatch just rebakes the font
+    int glyphCount = header[2];
+    int width = header[4];
+    int height = header[5];
+    int format = header[6];
+    if (glyphCount < 1 || glyphCount > FONT_MAX_GLYPHS || header[3] < 0 || header[3] > SDF_BASE_SIZE ||
+        width < 1 || width > FONT_MAX_ATLAS_SIZE || height < 1 || height > FONT_MAX_ATLAS_SIZE ||
+        format < PIXELFORMAT_UNCOMPRESSED_GRAYSCALE || format > PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
     {
-        currentState = GAME_STATE_ENDING_BAD;
-        return;
+        TraceLog(LOG_WARNING, "FONT: cabecalho invalido em %s, gerando o atlas de novo", path);
+        fclose(file);
+        return false;
     }
 
-    if (battleState == BATTLE_PLAYER_TURN)
+    // UnloadFont releases these with raylib's allocator, so allocate them with it too
+    Font result = {0};
+    result.baseSize = header[1];
+    result.glyphPadding = header[3];
+    result.glyphs = (GlyphInfo *)MemAlloc(sizeof(GlyphInfo) * glyphCount);
+    result.recs = (Rectangle *)MemAlloc(sizeof(Rectangle) * glyphCount);
+    bool ok = result.glyphs != NULL && result.recs != NULL;
+    if (ok)
+        result.glyphCount = glyphCount;
+
+    for (int i = 0; i < result.glyphCount && ok; i++)
     {
-        if (IsKeyPressed(KEY_RIGHT))
-            selectedItemIndex = (selectedItemIndex + 1) % INVENTORY_SIZE;
-        if (IsKeyPressed(KEY_LEFT))
-            selectedItemIndex = (selectedItemIndex - 1 + INVENTORY_SIZE) % INVENTORY_SIZE;
-        if (IsKeyPressed(KEY_A))
-            PlayerAttack();
-        if (IsKeyPressed(KEY_ENTER))
-            UseItem(selectedItemIndex);
+        int metrics[4];
+        ok = fread(metrics, sizeof(metrics), 1, file) == 1 && fread(&result.recs[i], sizeof(Rectangle), 1, file) == 1;
+        result.glyphs[i] = (GlyphInfo){metrics[0], metrics[1], metrics[2], metrics[3], {0}};
+        Rectangle r = result.recs[i];
+        ok = ok && r.x >= 0 && r.y >= 0 && r.width >= 0 && r.height >= 0 && r.x + r.width <= width && r.y + r.height <= height;
     }
-    else if (battleState == BATTLE_BOSS_TURN)
+
+    Image atlas = {0};
+    atlas.width = width;
+    atlas.height = height;
+    atlas.mipmaps = 1;
+    atlas.format = format;
+    int dataSize = GetPixelDataSize(atlas.width, atlas.height, atlas.format);
+    if (ok)
+        atlas.data = MemAlloc((unsigned int)dataSize);
+    ok = ok && atlas.data != NULL && fread(atlas.data, 1, (size_t)dataSize, file) == (size_t)dataSize;
+    fclose(file);
+
+    if (ok)
+        result.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+
+    if (!ok || result.texture.id == 0)
     {
-        bossTurnTimer -= GetFrameTime();
-        if (bossTurnTimer <= 0)
-        {
-            BossAttack();
-            battleState = BATTLE_PLAYER_TURN;
-        }
+        // glyphCount stays 0 unless both arrays exist, so UnloadFont never walks a missing glyph array
+        UnloadFont(result);
+        return false;
+    }
+    *font = result;
+    return true;
+}
+
+bool BakeSdfFont(Font *font, long sourceModTime)
+{
+    int dataSize = 0;
+    unsigned char *ttf = LoadFileData(FONT_FILE, &dataSize);
+    if (ttf == NULL)
+        return false;
+
+    int count = 0;
+    int *codepoints = FontCodepoints(&count);
+    Font result = {0};
+    result.baseSize = SDF_BASE_SIZE;
+    result.glyphCount = count;
+    result.glyphs = LoadFontData(ttf, dataSize, SDF_BASE_SIZE, codepoints, count, FONT_SDF);
+    UnloadFileData(ttf);
+    if (result.glyphs == NULL)
+        return false;
+
+    Image atlas = GenImageFontAtlas(result.glyphs, &result.recs, count, SDF_BASE_SIZE, 0, 1);
+    AddSolidAtlasBlock(&atlas);
+    result.texture = LoadTextureFromImage(atlas);
+    if (!SaveFontCache(FONT_CACHE_FILE, result, atlas, sourceModTime))
+        TraceLog(LOG_WARNING, "FONT: nao foi possivel gravar %s", FONT_CACHE_FILE);
+    UnloadImage(atlas);
+
+    *font = result;
+    return result.texture.id != 0;
+}
+
+void InitGameText(void)
+{
+    if (!FileExists(FONT_FILE))
+    {
+        TraceLog(LOG_INFO, "FONT: %s ausente, usando a fonte padrao do raylib", FONT_FILE);
+        return;
+    }
+
+    double start = GetTime();
+    long modTime = GetFileModTime(FONT_FILE);
+    fontFromCache = LoadFontCache(FONT_CACHE_FILE, modTime, &sdfFont);
+    if (!fontFromCache && !BakeSdfFont(&sdfFont, modTime))
+        return;
+
+    sdfShader = LoadShaderFromMemory(NULL, sdfFragmentShader);
+    SetTextureFilter(sdfFont.texture, TEXTURE_FILTER_BILINEAR);
+    TrackTexture(MEM_TAG_TEXT, sdfFont.texture);
+    sdfSolidRect = (Rectangle){SDF_SOLID_TEXELS / 2.0f, sdfFont.texture.height - SDF_SOLID_TEXELS / 2.0f, 0, 0};
+    sdfFontReady = true;
+
+    fontStartupMs = (GetTime() - start) * 1000.0;
+    TraceLog(LOG_INFO, "FONT: atlas SDF %dx%d %s em %.2f ms", sdfFont.texture.width, sdfFont.texture.height,
+             fontFromCache ? "lido do cache" : "gerado", fontStartupMs);
+}
+
+void UnloadGameText(void)
+{
+    if (!sdfFontReady)
+        return;
+
+    Texture2D texture = sdfFont.texture;
+    UnloadTrackedTexture(MEM_TAG_TEXT, &texture);
+    sdfFont.texture = texture;
+    UnloadFont(sdfFont);
+    UnloadShader(sdfShader);
+    sdfFontReady = false;
+}
+
+float GameTextSpacing(int fontSize)
+{
+    return sdfFontReady ? fontSize / 24.0f : fontSize / 10.0f;
+}
+
+int MeasureGameText(const char *text, int fontSize)
+{
+    if (!sdfFontReady || useLegacyText)
+        return MeasureText(text, fontSize);
+    return (int)MeasureTextEx(sdfFont, text, (float)fontSize, GameTextSpacing(fontSize)).x;
+}
+
+void FlushGameText(void)
+{
+    if (textCommandCount == 0)
+        return;
+
+    double start = GetTime();
+    BeginShaderMode(sdfShader);
+    for (int i = 0; i < textCommandCount; i++)
+    {
+        TextCommand *cmd = &textCommands[i];
+        DrawTextEx(sdfFont, &textArena[cmd->offset], cmd->position, cmd->size, GameTextSpacing((int)cmd->size), cmd->color);
+    }
+    EndShaderMode();
+    textFrameTime += GetTime() - start;
+
+    textCommandCount = 0;
+    textArenaUsed = 0;
+}
+
+// With an SDF font loaded, text is queued and drawn by FlushGameText as one batch of atlas quads.
+// Call FlushGameText before EndMode2D so world-space text keeps its transform, and before any
+// immediate draw that must cover text queued earlier.
+void DrawGameText(const char *text, int posX, int posY, int fontSize, Color color)
+{
+    double start = GetTime();
+    textFrameCalls++;
+
+    if (!sdfFontReady || useLegacyText)
+    {
+        DrawText(text, posX, posY, fontSize, color);
+        textFrameTime += GetTime() - start;
+        return;
+    }
+
+    int length = (int)strlen(text) + 1;
+    if (textCommandCount == MAX_TEXT_COMMANDS || textArenaUsed + length > TEXT_ARENA_SIZE)
+        FlushGameText();
+
+    memcpy(&textArena[textArenaUsed], text, (size_t)length);
+    textCommands[textCommandCount++] = (TextCommand){textArenaUsed, {(float)posX, (float)posY}, (float)fontSize, color};
+    textArenaUsed += length;
+    textFrameTime += GetTime() - start;
+}
+
+void EndGameTextFrame(void)
+{
+    FlushGameText();
+    textAverageMs = textAverageMs * 0.95 + textFrameTime * 1000.0 * 0.05;
+    textFrameTime = 0.0;
+    textFrameCalls = 0;
+}
+
+unsigned long long HashBytes(unsigned long long hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+bool UiBatched(void)
+{
+    return sdfFontReady && !useLegacyText;
+}
+
+// Returns true when the caller has to emit the layout again
+bool UiBegin(UiLayer *ui, unsigned long long key)
+{
+    key = HashBytes(key, &useLegacyText, sizeof(useLegacyText));
+    if (ui->valid && ui->key == key)
+        return false;
+
+    ui->key = key;
+    ui->valid = true;
+    ui->commandCount = 0;
+    ui->textUsed = 0;
+    ui->quadCount = 0;
+    return true;
+}
+
+void UiRect(UiLayer *ui, Rectangle rect, Color color)
+{
+    if (ui->commandCount < UI_MAX_COMMANDS)
+        ui->commands[ui->commandCount++] = (UiCommand){UI_RECT, rect, color, 0, 0};
+}
+
+void UiRectLines(UiLayer *ui, Rectangle rect, Color color)
+{
+    UiRect(ui, (Rectangle){rect.x, rect.y, rect.width, 1}, color);
+    UiRect(ui, (Rectangle){rect.x, rect.y + rect.height - 1, rect.width, 1}, color);
+    UiRect(ui, (Rectangle){rect.x, rect.y + 1, 1, rect.height - 2}, color);
+    UiRect(ui, (Rectangle){rect.x + rect.width - 1, rect.y + 1, 1, rect.height - 2}, color);
+}
+
+void UiText(UiLayer *ui, const char *text, int posX, int posY, int fontSize, Color color)
+{
+    int length = (int)strlen(text) + 1;
+    if (ui->commandCount == UI_MAX_COMMANDS || ui->textUsed + length > UI_TEXT_ARENA_SIZE)
+        return;
+
+    memcpy(&ui->text[ui->textUsed], text, (size_t)length);
+    ui->commands[ui->commandCount++] = (UiCommand){UI_TEXT, {(float)posX, (float)posY, 0, 0}, color, ui->textUsed, fontSize};
+    ui->textUsed += length;
+}
+
+void UiPushQuad(UiLayer *ui, Rectangle dest, Rectangle source, Color color)
+{
+    if (ui->quadCount < UI_MAX_QUADS)
+        ui->quads[ui->quadCount++] = (UiQuad){dest, source, color};
+}
+
+// Lays glyphs out the way DrawTextEx does, once, so cached frames only replay vertices
+void UiLayoutText(UiLayer *ui, const UiCommand *cmd)
+{
+    const char *text = &ui->text[cmd->textOffset];
+    float scale = cmd->fontSize / (float)sdfFont.baseSize;
+    float spacing = GameTextSpacing(cmd->fontSize);
+    float padding = (float)sdfFont.glyphPadding;
+    float x = cmd->rect.x;
+    float y = cmd->rect.y;
+
+    for (int i = 0; text[i] != '\0';)
+    {
+        int bytes = 0;
+        int codepoint = GetCodepointNext(&text[i], &bytes);
+        i += bytes;
+        if (codepoint == '\n')
+        {
+            x = cmd->rect.x;
+            y += cmd->fontSize + 2;
+            continue;
+        }
+
+        int index = GetGlyphIndex(sdfFont, codepoint);
+        Rectangle rec = sdfFont.recs[index];
+        GlyphInfo glyph = sdfFont.glyphs[index];
+        if (codepoint != ' ' && codepoint != '\t')
+        {
+            Rectangle dest = {x + (glyph.offsetX - padding) * scale, y + (glyph.offsetY - padding) * scale,
+                              (rec.width + 2 * padding) * scale, (rec.height + 2 * padding) * scale};
+            Rectangle source = {rec.x - padding, rec.y - padding, rec.width + 2 * padding, rec.height + 2 * padding};
+            UiPushQuad(ui, dest, source, cmd->color);
+        }
+        x += ((glyph.advanceX == 0) ? rec.width : (float)glyph.advanceX) * scale + spacing;
+    }
+}
+
+void UiEnd(UiLayer *ui)
+{
+    if (!UiBatched())
+        return;
+
+    for (int i = 0; i < ui->commandCount; i++)
+    {
+        const UiCommand *cmd = &ui->commands[i];
+        if (cmd->type == UI_RECT)
+            UiPushQuad(ui, cmd->rect, sdfSolidRect, cmd->color);
+        else
+            UiLayoutText(ui, cmd);
+    }
+}
+
+void UiDraw(const UiLayer *ui)
+{
+    if (!UiBatched())
+    {
+        for (int i = 0; i < ui->commandCount; i++)
+        {
+            const UiCommand *cmd = &ui->commands[i];
+            if (cmd->type == UI_RECT)
+                DrawRectangleRec(cmd->rect, cmd->color);
+            else
+                DrawGameText(&ui->text[cmd->textOffset], (int)cmd->rect.x, (int)cmd->rect.y, cmd->fontSize, cmd->color);
+        }
+        // Estimate: rectangles and default-font glyphs share raylib's shapes texture, so rlgl keeps one batch
+        hudDrawCalls = 1;
+        return;
+    }
+
+    float width = (float)sdfFont.texture.width;
+    float height = (float)sdfFont.texture.height;
+    BeginShaderMode(sdfShader);
+    rlSetTexture(sdfFont.texture.id);
+    rlBegin(RL_QUADS);
+    for (int i = 0; i < ui->quadCount; i++)
+    {
+        const UiQuad *quad = &ui->quads[i];
+        float u0 = quad->source.x / width;
+        float v0 = quad->source.y / height;
+        float u1 = (quad->source.x + quad->source.width) / width;
+        float v1 = (quad->source.y + quad->source.height) / height;
+        Rectangle d = quad->dest;
+
+        rlColor4ub(quad->color.r, quad->color.g, quad->color.b, quad->color.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        rlTexCoord2f(u0, v0);
+        rlVertex2f(d.x, d.y);
+        rlTexCoord2f(u0, v1);
+        rlVertex2f(d.x, d.y + d.height);
+        rlTexCoord2f(u1, v1);
+        rlVertex2f(d.x + d.width, d.y + d.height);
+        rlTexCoord2f(u1, v0);
+        rlVertex2f(d.x + d.width, d.y);
+    }
+    rlEnd();
+    rlSetTexture(0);
+    EndShaderMode();
+    // Estimate: rlgl flushes once per full vertex buffer, its real draw counter is not public
+    hudDrawCalls = 1 + ui->quadCount / RL_DEFAULT_BATCH_BUFFER_ELEMENTS;
+}
+
+void DrawMemoryOverlay(void)
+{
+    int x = 10;
+    int y = SCREEN_HEIGHT / 2 - 80;
+    DrawRectangle(x - 5, y - 5, 360, 30 + 18 * (MEM_TAG_COUNT + 7), (Color){0, 0, 0, 180});
+    DrawGameText("Memória (KB)   heap / pico   vram / pico", x, y, 12, YELLOW);
+    y += 20;
+    for (int i = 0; i < MEM_TAG_COUNT; i++)
+    {
+        MemoryStats *stats = &memoryStats[i];
+        DrawGameText(TextFormat("%-10s %6ld / %-6ld  %6ld / %-6ld", memoryTagNames[i], stats->heapBytes / 1024, stats->peakHeapBytes / 1024,
+                            stats->textureBytes / 1024, stats->peakTextureBytes / 1024),
+                 x, y, 12, WHITE);
+        y += 18;
+    }
+    DrawGameText(TextFormat("total %ld KB (pico %ld KB)", MemoryTotalBytes() / 1024, peakTotalBytes / 1024), x, y, 12, LIGHTGRAY);
+    y += 18;
+    if (tileMap.chunks)
+        DrawGameText(TextFormat("mapa: %d chunks visíveis, %d refeitos, %d lidos do disco", tileMap.chunksDrawn, tileMap.chunksRebuilt, tileMap.chunksStreamed),
+                 x, y, 12, LIGHTGRAY);
+    y += 18;
+    DrawGameText(TextFormat("texto: %.3f ms/quadro, %s [F4], fonte %s em %.1f ms", textAverageMs,
+                            (sdfFontReady && !useLegacyText) ? "atlas SDF" : "DrawText",
+                            fontFromCache ? "do cache" : "gerada", fontStartupMs),
+                 x, y, 12, LIGHTGRAY);
+    y += 18;
+    DrawGameText(TextFormat("quadros: %ld desenhados, %ld pulados, ~%.2f s CPU poupados", framesDrawn, framesSkipped, cpuTimeSaved),
+                 x, y, 12, LIGHTGRAY);
+    y += 18;
+    DrawGameText(TextFormat("%s: sim %.2f ms, desenho %.2f ms, latência %.1f ms", pipelined ? "paralelo" : "serial",
+                            simTimeAverage * 1000.0, drawTimeAverage * 1000.0, latencyAverage * 1000.0),
+                 x, y, 12, LIGHTGRAY);
+    y += 18;
+    if (captureActive)
+        DrawGameText(TextFormat("gravando [F9]: %ld quadros, %ld descartados, %.1f fps, +%.3f ms", captureFramesWritten,
+                                captureFramesDropped, captureFramesWritten / fmax(GetTime() - captureStartTime, 0.001),
+                                captureCostAverage * 1000.0),
+                     x, y, 12, RED);
+    else
+        DrawGameText("gravação desligada [F9]", x, y, 12, LIGHTGRAY);
+    y += 18;
+    if (useLegacyHud)
+        DrawGameText(TextFormat("HUD antigo [F5]: %d primitivas, ~%d draw calls, %.3f ms", hudPrimitives, hudDrawCalls, hudCpuAverage * 1000.0),
+                     x, y, 12, LIGHTGRAY);
+    else
+        DrawGameText(TextFormat("HUD em lote [F5]: %d quads, ~%d draw call(s), %.3f ms, cache %.0f%%", hudPrimitives, hudDrawCalls,
+                                hudCpuAverage * 1000.0, hudFrames > 0 ? 100.0 * hudCacheHits / hudFrames : 0.0),
+                     x, y, 12, LIGHTGRAY);
+}
+
+bool FindSourceAsset(const char *baseName, char *path)
+{
+    const char *extensions[] = {"png", "jpg", "bmp"};
+    for (int i = 0; i < 3; i++)
+    {
+        sprintf(path, "assets/%s.%s", baseName, extensions[i]);
+        if (FileExists(path))
+            return true;
+    }
+    return false;
+}
+
+// rlgl turns on trilinear filtering for any texture with mipmaps but leaves GL_TEXTURE_MAX_LEVEL at its
+// default, so a chain that stops before 1x1 (the converted DXT1 backgrounds) would be incomplete and sample
+// black. Without the GL entry point, fall back to plain bilinear, which only needs the top level.
+void LimitMipLevels(Texture2D texture)
+{
+    if (texture.id == 0 || texture.mipmaps <= 1)
+        return;
+
+    GlTexParameteriProc glTexParameteriFn = (GlTexParameteriProc)glfwGetProcAddress("glTexParameteri");
+    if (!glTexParameteriFn)
+    {
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+        return;
+    }
+    rlEnableTexture(texture.id);
+    glTexParameteriFn(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.mipmaps - 1);
+    rlDisableTexture();
+}
+
+Texture2D LoadAsset(const char *baseName)
+{
+    char path[128];
+    Texture2D texture = {0};
+
+    // Variants written by --convert-assets: DXT1 (desktop), ETC2 (GLES, external tool), then pre-scaled
+    // uncompressed. raylib returns id 0 when the GPU lacks a compressed format, so we fall through.
+    // A variant older than its source image is stale and skipped until the converter runs again.
+    char sourcePath[128];
+    long sourceModTime = FindSourceAsset(baseName, sourcePath) ? GetFileModTime(sourcePath) : 0;
+    const char *variants[] = {"dds", "ktx", "scaled.png"};
+    for (int i = 0; i < 3 && texture.id == 0; i++)
+    {
+        sprintf(path, "assets/%s.%s", baseName, variants[i]);
+        if (!FileExists(path))
+            continue;
+        if (GetFileModTime(path) < sourceModTime)
+        {
+            TraceLog(LOG_WARNING, "ASSET: [%s] mais antigo que %s, rode --convert-assets", path, sourcePath);
+            continue;
+        }
+        texture = LoadTexture(path);
+        LimitMipLevels(texture);
+    }
+
+    if (texture.id == 0 && FindSourceAsset(baseName, path))
+        texture = LoadTexture(path);
+
+    if (texture.id != 0)
+        TraceLog(LOG_INFO, "ASSET: [%s] %dx%d, %d mipmaps, %d bytes", path, texture.width, texture.height, texture.mipmaps, TextureByteSize(texture));
+
+    return TrackTexture(MEM_TAG_ASSETS, texture);
+}
+
+unsigned short PackRgb565(int r, int g, int b)
+{
+    return (unsigned short)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+void UnpackRgb565(unsigned short c, int *rgb)
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+void EncodeDxt1Block(const Color *pixels, int width, int height, int bx, int by, unsigned char *out)
+{
+    int block[16][3];
+    int minC[3] = {255, 255, 255};
+    int maxC[3] = {0, 0, 0};
+
+    for (int i = 0; i < 16; i++)
+    {
+        int x = (bx + i % 4 < width) ? bx + i % 4 : width - 1;
+        int y = (by + i / 4 < height) ? by + i / 4 : height - 1;
+        Color p = pixels[y * width + x];
+        block[i][0] = p.r;
+        block[i][1] = p.g;
+        block[i][2] = p.b;
+        for (int c = 0; c < 3; c++)
+        {
+            if (block[i][c] < minC[c])
+                minC[c] = block[i][c];
+            if (block[i][c] > maxC[c])
+                maxC[c] = block[i][c];
+        }
+    }
+
+    // Pull the endpoints slightly inside the bounding box, it lowers the average error
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (maxC[c] - minC[c]) >> 4;
+        minC[c] += inset;
+        maxC[c] -= inset;
+    }
+
+    // The box has four diagonals; follow the one matching how green and blue vary against red
+    int mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += block[i][c];
+    int covRG = 0;
+    int covRB = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int dr = block[i][0] * 16 - mean[0];
+        covRG += dr * (block[i][1] * 16 - mean[1]);
+        covRB += dr * (block[i][2] * 16 - mean[2]);
+    }
+    for (int c = 1; c < 3; c++)
+    {
+        if ((c == 1 ? covRG : covRB) < 0)
+        {
+            int tmp = minC[c];
+            minC[c] = maxC[c];
+            maxC[c] = tmp;
+        }
+    }
+
+    unsigned short c0 = PackRgb565(maxC[0], maxC[1], maxC[2]);
+    unsigned short c1 = PackRgb565(minC[0], minC[1], minC[2]);
+    if (c0 < c1)
+    {
+        unsigned short tmp = c0;
+        c0 = c1;
+        c1 = tmp;
+    }
+
+    int palette[4][3];
+    UnpackRgb565(c0, palette[0]);
+    UnpackRgb565(c1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    unsigned int indices = 0;
+    if (c0 != c1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestDist = 0x7fffffff;
+            for (int k = 0; k < 4; k++)
+            {
+                int dr = block[i][0] - palette[k][0];
+                int dg = block[i][1] - palette[k][1];
+                int db = block[i][2] - palette[k][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+            indices |= (unsigned int)best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+bool SaveDxt1Dds(const char *path, const unsigned char *data, int dataSize, int topLevelSize, int width, int height, int mipmaps)
+{
+    unsigned int header[32] = {0};
+    header[0] = 0x20534444;                                          // "DDS "
+    header[1] = 124;                                                 // header size
+    header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000 | (mipmaps > 1 ? 0x20000 : 0);
+    header[3] = (unsigned int)height;
+    header[4] = (unsigned int)width;
+    header[5] = (unsigned int)topLevelSize;
+    header[7] = (unsigned int)mipmaps;
+    header[19] = 32;                                                 // pixel format size
+    header[20] = 0x4;                                                // DDPF_FOURCC
+    header[21] = 0x31545844;                                         // "DXT1"
+    header[27] = 0x1000 | (mipmaps > 1 ? 0x400008 : 0);
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    fwrite(header, sizeof(header), 1, file);
+    fwrite(data, 1, (size_t)dataSize, file);
+
+    // raylib's DDS loader copies twice the top level size when mipmaps are present
+    for (int i = dataSize; i < 2 * topLevelSize; i++)
+        fputc(0, file);
+
+    fclose(file);
+    return true;
+}
+
+int AlignUp(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int ConvertAssets(void)
+{
+    const char *backgrounds[] = {
+        "cenarios/title_bg", "cenarios/battle_bg", "cenarios/escapeEnding", "cenarios/wonEnding", "cenarios/loseEnding",
+        "cenarios/cenario1", "cenarios/cenario2", "cenarios/cenario3", "cenarios/cenario4"};
+    int count = sizeof(backgrounds) / sizeof(backgrounds[0]);
+    long totalBefore = 0;
+    long totalAfter = 0;
+
+    printf("%-24s %-11s %10s   %-11s %10s %7s\n", "textura", "origem", "bytes", "destino", "bytes", "reducao");
+    for (int i = 0; i < count; i++)
+    {
+        char path[128];
+        if (!FindSourceAsset(backgrounds[i], path))
+        {
+            printf("%-24s nao encontrada\n", backgrounds[i]);
+            continue;
+        }
+
+        Image image = LoadImage(path);
+        if (image.data == NULL)
+            continue;
+
+        int srcWidth = image.width;
+        int srcHeight = image.height;
+        int before = GetPixelDataSize(image.width, image.height, image.format);
+
+        // Backgrounds are always drawn at SCREEN_WIDTH x SCREEN_HEIGHT; multiples of 64 keep
+        // every mip level a multiple of the 4x4 block size down to 1/16 scale.
+        int width = AlignUp(srcWidth < SCREEN_WIDTH ? srcWidth : SCREEN_WIDTH, 64);
+        int height = AlignUp(srcHeight < SCREEN_HEIGHT ? srcHeight : SCREEN_HEIGHT, 64);
+
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        ImageResize(&image, width, height);
+
+        Image scaled = ImageCopy(image);
+        ImageFormat(&scaled, PIXELFORMAT_UNCOMPRESSED_R8G8B8);
+        sprintf(path, "assets/%s.scaled.png", backgrounds[i]);
+        ExportImage(scaled, path);
+        UnloadImage(scaled);
+
+        ImageMipmaps(&image);
+
+        // rlgl sizes each compressed level as w*h/2 bytes, which only matches the DXT1 block layout while
+        // both sides are multiples of 4, so the chain stops at the last aligned level (64x44 for a
+        // 1024x704 background) and LoadAsset caps GL_TEXTURE_MAX_LEVEL to match.
+        int levels = 0;
+        int dataSize = 0;
+        int topLevelSize = (width / 4) * (height / 4) * 8;
+        int w = width;
+        int h = height;
+        while (levels < image.mipmaps && w % 4 == 0 && h % 4 == 0)
+        {
+            dataSize += (w / 4) * (h / 4) * 8;
+            levels++;
+            w /= 2;
+            h /= 2;
+        }
+
+        unsigned char *blocks = (unsigned char *)TrackedAlloc(MEM_TAG_ASSETS, (size_t)dataSize);
+        unsigned char *out = blocks;
+        const unsigned char *level = (const unsigned char *)image.data;
+        w = width;
+        h = height;
+        for (int l = 0; l < levels; l++)
+        {
+            for (int by = 0; by < h; by += 4)
+                for (int bx = 0; bx < w; bx += 4)
+                {
+                    EncodeDxt1Block((const Color *)level, w, h, bx, by, out);
+                    out += 8;
+                }
+            level += GetPixelDataSize(w, h, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            w /= 2;
+            h /= 2;
+        }
+
+        sprintf(path, "assets/%s.dds", backgrounds[i]);
+        if (!SaveDxt1Dds(path, blocks, dataSize, topLevelSize, width, height, levels))
+            printf("%-24s falha ao gravar %s\n", backgrounds[i], path);
+
+        printf("%-24s %5dx%-5d %10d   %5dx%-5d %10d %6.1fx\n", backgrounds[i], srcWidth, srcHeight, before,
+               width, height, dataSize, (float)before / dataSize);
+        totalBefore += before;
+        totalAfter += dataSize;
+
+        TrackedFree(blocks);
+        UnloadImage(image);
+    }
+
+    if (totalAfter > 0)
+        printf("%-24s %11s %10ld   %11s %10ld %6.1fx\n", "total", "", totalBefore, "", totalAfter, (float)totalBefore / totalAfter);
+    printf("pico de memoria do conversor: %ld bytes\n", memoryStats[MEM_TAG_ASSETS].peakHeapBytes);
+
+    return 0;
+}
+
+unsigned int TileNoiseHash(int x, int y, unsigned int seed)
+{
+    unsigned int h = (unsigned int)x * 374761393u + (unsigned int)y * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return h ^ (h >> 16);
+}
+
+float TileValueNoise(float x, float y, unsigned int seed)
+{
+    int x0 = (int)floorf(x);
+    int y0 = (int)floorf(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    fx = fx * fx * (3 - 2 * fx);
+    fy = fy * fy * (3 - 2 * fy);
+
+    float v00 = (TileNoiseHash(x0, y0, seed) & 0xffff) / 65535.0f;
+    float v10 = (TileNoiseHash(x0 + 1, y0, seed) & 0xffff) / 65535.0f;
+    float v01 = (TileNoiseHash(x0, y0 + 1, seed) & 0xffff) / 65535.0f;
+    float v11 = (TileNoiseHash(x0 + 1, y0 + 1, seed) & 0xffff) / 65535.0f;
+    float top = v00 + (v10 - v00) * fx;
+    float bottom = v01 + (v11 - v01) * fx;
+    return top + (bottom - top) * fy;
+}
+
+unsigned char GenerateTile(int x, int y)
+{
+    float n = 0.65f * TileValueNoise(x / 40.0f, y / 40.0f, 1) + 0.35f * TileValueNoise(x / 9.0f, y / 9.0f, 2);
+    if (n < 0.30f)
+        return TILE_WATER;
+    if (n < 0.36f)
+        return TILE_SAND;
+    if (n < 0.62f)
+        return TILE_GRASS;
+    if (n < 0.74f)
+        return TILE_FOREST;
+    return TILE_STONE;
+}
+
+int EncodeChunkRle(const unsigned char *tiles, unsigned char *out)
+{
+    int size = 0;
+    int i = 0;
+    while (i < CHUNK_TILES * CHUNK_TILES)
+    {
+        int run = 1;
+        while (i + run < CHUNK_TILES * CHUNK_TILES && run < 255 && tiles[i + run] == tiles[i])
+            run++;
+        out[size++] = (unsigned char)run;
+        out[size++] = tiles[i];
+        i += run;
+    }
+    return size;
+}
+
+// Layout: "RMAP", u16 version, u16 chunk tiles, u32 width, u32 height, u32 offsets[chunks + 1], RLE chunk data
+bool GenerateTileMapFile(const char *path, int widthTiles, int heightTiles)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    int chunkCols = (widthTiles + CHUNK_TILES - 1) / CHUNK_TILES;
+    int chunkRows = (heightTiles + CHUNK_TILES - 1) / CHUNK_TILES;
+    int chunkCount = chunkCols * chunkRows;
+    unsigned short version = 1;
+    unsigned short chunkTiles = CHUNK_TILES;
+    unsigned int size[2] = {(unsigned int)widthTiles, (unsigned int)heightTiles};
+    unsigned int *offsets = (unsigned int *)TrackedAlloc(MEM_TAG_WORLD, sizeof(unsigned int) * (chunkCount + 1));
+
+    fwrite("RMAP", 1, 4, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&chunkTiles, sizeof(chunkTiles), 1, file);
+    fwrite(size, sizeof(size), 1, file);
+    long tableStart = ftell(file);
+    fwrite(offsets, sizeof(unsigned int), chunkCount + 1, file);
+
+    unsigned char tiles[CHUNK_TILES * CHUNK_TILES];
+    unsigned char encoded[CHUNK_TILES * CHUNK_TILES * 2];
+    for (int c = 0; c < chunkCount; c++)
+    {
+        int baseX = (c % chunkCols) * CHUNK_TILES;
+        int baseY = (c / chunkCols) * CHUNK_TILES;
+        for (int i = 0; i < CHUNK_TILES * CHUNK_TILES; i++)
+        {
+            int x = baseX + i % CHUNK_TILES;
+            int y = baseY + i / CHUNK_TILES;
+            tiles[i] = (x < widthTiles && y < heightTiles) ? GenerateTile(x, y) : TILE_EMPTY;
+        }
+        offsets[c] = (unsigned int)ftell(file);
+        fwrite(encoded, 1, (size_t)EncodeChunkRle(tiles, encoded), file);
+    }
+    offsets[chunkCount] = (unsigned int)ftell(file);
+
+    fseek(file, tableStart, SEEK_SET);
+    fwrite(offsets, sizeof(unsigned int), chunkCount + 1, file);
+    fclose(file);
+    TrackedFree(offsets);
+    return true;
+}
+
+void UnloadTileMap(TileMap *map)
+{
+    for (int i = 0; i < CHUNK_CACHE_SLOTS; i++)
+    {
+        if (map->cache[i].target.id != 0)
+        {
+            TrackTextureBytes(MEM_TAG_RENDERING, -TextureByteSize(map->cache[i].target.texture));
+            if (map->cache[i].target.depth.id != 0)
+                TrackTextureBytes(MEM_TAG_RENDERING, -RenderTargetDepthBytes(map->cache[i].target));
+            UnloadRenderTexture(map->cache[i].target);
+        }
+    }
+    if (map->chunks)
+    {
+        for (int i = 0; i < map->chunkCols * map->chunkRows; i++)
+            TrackedFree(map->chunks[i].tiles);
+    }
+    TrackedFree(map->chunks);
+    TrackedFree(map->chunkOffsets);
+    if (map->file)
+        fclose(map->file);
+    *map = (TileMap){0};
+}
+
+bool LoadTileMap(TileMap *map, const char *path)
+{
+    *map = (TileMap){0};
+    map->file = fopen(path, "rb");
+    if (!map->file)
+        return false;
+
+    char magic[4];
+    unsigned short version = 0;
+    unsigned short chunkTiles = 0;
+    unsigned int size[2] = {0, 0};
+    if (fread(magic, 1, 4, map->file) != 4 || memcmp(magic, "RMAP", 4) != 0 ||
+        fread(&version, sizeof(version), 1, map->file) != 1 || version != 1 ||
+        fread(&chunkTiles, sizeof(chunkTiles), 1, map->file) != 1 || chunkTiles != CHUNK_TILES ||
+        fread(size, sizeof(size), 1, map->file) != 1 ||
+        size[0] == 0 || size[0] > MAP_MAX_TILES || size[1] == 0 || size[1] > MAP_MAX_TILES)
+    {
+        TraceLog(LOG_WARNING, "MAP: [%s] formato invalido", path);
+        UnloadTileMap(map);
+        return false;
+    }
+
+    map->widthTiles = (int)size[0];
+    map->heightTiles = (int)size[1];
+    map->chunkCols = (map->widthTiles + CHUNK_TILES - 1) / CHUNK_TILES;
+    map->chunkRows = (map->heightTiles + CHUNK_TILES - 1) / CHUNK_TILES;
+    int chunkCount = map->chunkCols * map->chunkRows;
+
+    map->chunkOffsets = (unsigned int *)TrackedAlloc(MEM_TAG_WORLD, sizeof(unsigned int) * (chunkCount + 1));
+    map->chunks = (MapChunk *)TrackedCalloc(MEM_TAG_WORLD, (size_t)chunkCount, sizeof(MapChunk));
+    if (!map->chunkOffsets || !map->chunks ||
+        fread(map->chunkOffsets, sizeof(unsigned int), chunkCount + 1, map->file) != (size_t)(chunkCount + 1))
+    {
+        TraceLog(LOG_WARNING, "MAP: [%s] tabela de chunks truncada", path);
+        UnloadTileMap(map);
+        return false;
+    }
+
+    // Chunks are stored back to back after the table, so the offsets must be increasing and inside the file
+    long tableEnd = ftell(map->file);
+    fseek(map->file, 0, SEEK_END);
+    long fileSize = ftell(map->file);
+    for (int i = 0; i <= chunkCount; i++)
+    {
+        unsigned int previous = (i == 0) ? (unsigned int)tableEnd : map->chunkOffsets[i - 1];
+        if (map->chunkOffsets[i] < previous || map->chunkOffsets[i] > (unsigned long)fileSize)
+        {
+            TraceLog(LOG_WARNING, "MAP: [%s] offsets de chunk corrompidos", path);
+            UnloadTileMap(map);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < chunkCount; i++)
+        map->chunks[i].cacheSlot = -1;
+    for (int i = 0; i < CHUNK_CACHE_SLOTS; i++)
+        map->cache[i].chunk = -1;
+
+    TraceLog(LOG_INFO, "MAP: [%s] %dx%d tiles, %d chunks", path, map->widthTiles, map->heightTiles, chunkCount);
+    return true;
+}
+
+bool StreamChunk(TileMap *map, int chunk)
+{
+    MapChunk *c = &map->chunks[chunk];
+    if (c->tiles)
+        return true;
+
+    unsigned char encoded[CHUNK_TILES * CHUNK_TILES * 2];
+    unsigned int length = map->chunkOffsets[chunk + 1] - map->chunkOffsets[chunk];
+    if (length > sizeof(encoded) || fseek(map->file, (long)map->chunkOffsets[chunk], SEEK_SET) != 0 ||
+        fread(encoded, 1, length, map->file) != length)
+        return false;
+
+    c->tiles = (unsigned char *)TrackedCalloc(MEM_TAG_WORLD, CHUNK_TILES * CHUNK_TILES, 1);
+    if (!c->tiles)
+        return false;
+    int pos = 0;
+    for (unsigned int i = 0; i + 1 < length; i += 2)
+    {
+        unsigned char tile = (encoded[i + 1] < TILE_TYPE_COUNT) ? encoded[i + 1] : TILE_EMPTY;
+        for (int run = 0; run < encoded[i] && pos < CHUNK_TILES * CHUNK_TILES; run++)
+            c->tiles[pos++] = tile;
+    }
+    c->dirty = true;
+    map->chunksStreamed++;
+    return true;
+}
+
+void SetMapTile(TileMap *map, int x, int y, unsigned char tile)
+{
+    if (!map->chunks || x < 0 || y < 0 || x >= map->widthTiles || y >= map->heightTiles)
+        return;
+
+    int chunk = (y / CHUNK_TILES) * map->chunkCols + x / CHUNK_TILES;
+    if (!StreamChunk(map, chunk))
+        return;
+
+    unsigned char *cell = &map->chunks[chunk].tiles[(y % CHUNK_TILES) * CHUNK_TILES + x % CHUNK_TILES];
+    if (*cell != tile)
+    {
+        *cell = tile;
+        map->chunks[chunk].dirty = true;
+    }
+}
+
+int AcquireChunkSlot(TileMap *map, int chunk)
+{
+    int slot = -1;
+    for (int i = 0; i < CHUNK_CACHE_SLOTS; i++)
+    {
+        if (map->cache[i].chunk == -1)
+        {
+            slot = i;
+            break;
+        }
+        if (map->cache[i].lastUsed != map->frame && (slot == -1 || map->cache[i].lastUsed < map->cache[slot].lastUsed))
+            slot = i;
+    }
+    if (slot == -1)
+        return -1;
+
+    ChunkCacheSlot *entry = &map->cache[slot];
+    if (entry->chunk != -1)
+        map->chunks[entry->chunk].cacheSlot = -1;
+    if (entry->target.id == 0)
+    {
+        entry->target = LoadRenderTexture(CHUNK_PIXELS, CHUNK_PIXELS);
+        TrackTexture(MEM_TAG_RENDERING, entry->target.texture);
+        if (entry->target.depth.id != 0)
+            TrackTextureBytes(MEM_TAG_RENDERING, RenderTargetDepthBytes(entry->target));
+    }
+    entry->chunk = chunk;
+    map->chunks[chunk].cacheSlot = slot;
+    map->chunks[chunk].dirty = true;
+    return slot;
+}
+
+void RebuildChunk(TileMap *map, int chunk)
+{
+    MapChunk *c = &map->chunks[chunk];
+    BeginTextureMode(map->cache[c->cacheSlot].target);
+    ClearBackground(BLANK);
+    for (int i = 0; i < CHUNK_TILES * CHUNK_TILES; i++)
+    {
+        unsigned char tile = c->tiles[i];
+        if (tile == TILE_EMPTY || tile >= TILE_TYPE_COUNT)
+            continue;
+
+        int x = (i % CHUNK_TILES) * TILE_SIZE;
+        int y = (i / CHUNK_TILES) * TILE_SIZE;
+        if (tilesetTexture.id != 0)
+        {
+            Rectangle src = {(float)((tile - 1) * TILE_SIZE), 0, TILE_SIZE, TILE_SIZE};
+            DrawTextureRec(tilesetTexture, src, (Vector2){(float)x, (float)y}, WHITE);
+        }
+        else
+        {
+            DrawRectangle(x, y, TILE_SIZE, TILE_SIZE, tileColors[tile]);
+            if (tile != TILE_WATER && (i * 7 + chunk) % 11 == 0)
+                DrawRectangle(x + 5, y + 5, 3, 3, ColorBrightness(tileColors[tile], -0.25f));
+        }
+    }
+    EndTextureMode();
+    c->dirty = false;
+    map->chunksRebuilt++;
+}
+
+void ChunkRangeForView(const TileMap *map, Rectangle view, int *minX, int *minY, int *maxX, int *maxY)
+{
+    *minX = (int)fmaxf(0, floorf(view.x / CHUNK_PIXELS));
+    *minY = (int)fmaxf(0, floorf(view.y / CHUNK_PIXELS));
+    *maxX = (int)fminf(map->chunkCols - 1, floorf((view.x + view.width) / CHUNK_PIXELS));
+    *maxY = (int)fminf(map->chunkRows - 1, floorf((view.y + view.height) / CHUNK_PIXELS));
+}
+
+// Must run outside BeginMode2D: BeginTextureMode resets the modelview matrix
+void PrepareTileMap(TileMap *map, Rectangle view)
+{
+    int minX, minY, maxX, maxY;
+    map->frame++;
+    map->chunksRebuilt = 0;
+    ChunkRangeForView(map, view, &minX, &minY, &maxX, &maxY);
+
+    for (int cy = minY; cy <= maxY; cy++)
+    {
+        for (int cx = minX; cx <= maxX; cx++)
+        {
+            int chunk = cy * map->chunkCols + cx;
+            if (!StreamChunk(map, chunk))
+                continue;
+            if (map->chunks[chunk].cacheSlot == -1 && AcquireChunkSlot(map, chunk) == -1)
+                continue;
+
+            map->cache[map->chunks[chunk].cacheSlot].lastUsed = map->frame;
+            if (map->chunks[chunk].dirty)
+                RebuildChunk(map, chunk);
+        }
+    }
+}
+
+void DrawTileMap(TileMap *map, Rectangle view, Color tint)
+{
+    int minX, minY, maxX, maxY;
+    map->chunksDrawn = 0;
+    ChunkRangeForView(map, view, &minX, &minY, &maxX, &maxY);
+
+    for (int cy = minY; cy <= maxY; cy++)
+    {
+        for (int cx = minX; cx <= maxX; cx++)
+        {
+            const MapChunk *c = &map->chunks[cy * map->chunkCols + cx];
+            if (c->cacheSlot == -1 || c->dirty)
+                continue;
+
+            // Render textures are stored bottom-up
+            Texture2D texture = map->cache[c->cacheSlot].target.texture;
+            Rectangle src = {0, 0, (float)CHUNK_PIXELS, -(float)CHUNK_PIXELS};
+            DrawTextureRec(texture, src, (Vector2){(float)(cx * CHUNK_PIXELS), (float)(cy * CHUNK_PIXELS)}, tint);
+            map->chunksDrawn++;
+        }
+    }
+}
+
+// rand() tops out at 32767 on some C runtimes, far below the world and benchmark extents
+void SeedWorldRandom(unsigned int seed)
+{
+    worldRngState = seed ? seed : 2463534242u;
+}
+
+unsigned int WorldRandom(void)
+{
+    unsigned int x = worldRngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worldRngState = x;
+    return x;
+}
+
+float WorldRandomRange(float max)
+{
+    return (float)((double)WorldRandom() / 4294967296.0 * max);
+}
+
+bool InitSpatialHash(SpatialHash *hash, float width, float height, float cellSize)
+{
+    hash->cellSize = cellSize;
+    hash->cols = (int)ceilf(width / cellSize);
+    hash->rows = (int)ceilf(height / cellSize);
+    hash->maxHalfExtent = 0.0f;
+    hash->cellHeads = (int *)TrackedAlloc(MEM_TAG_WORLD, sizeof(int) * hash->cols * hash->rows);
+    if (hash->cellHeads == NULL)
+        return false;
+
+    for (int i = 0; i < hash->cols * hash->rows; i++)
+        hash->cellHeads[i] = -1;
+    return true;
+}
+
+void FreeSpatialHash(SpatialHash *hash)
+{
+    TrackedFree(hash->cellHeads);
+    hash->cellHeads = NULL;
+}
+
+void ClearSpatialHash(SpatialHash *hash)
+{
+    for (int i = 0; i < hash->cols * hash->rows; i++)
+        hash->cellHeads[i] = -1;
+    hash->maxHalfExtent = 0.0f;
+}
+
+int SpatialHashCell(const SpatialHash *hash, float x, float y)
+{
+    int cx = (int)(x / hash->cellSize);
+    int cy = (int)(y / hash->cellSize);
+    if (cx < 0)
+        cx = 0;
+    if (cx >= hash->cols)
+        cx = hash->cols - 1;
+    if (cy < 0)
+        cy = 0;
+    if (cy >= hash->rows)
+        cy = hash->rows - 1;
+    return cy * hash->cols + cx;
+}
+
+int EntityCell(const SpatialHash *hash, const WorldEntity *entity)
+{
+    return SpatialHashCell(hash, entity->rect.x + entity->rect.width / 2, entity->rect.y + entity->rect.height / 2);
+}
+
+void SpatialHashInsert(SpatialHash *hash, WorldEntity *entities, int index)
+{
+    WorldEntity *entity = &entities[index];
+    int cell = EntityCell(hash, entity);
+    entity->cell = cell;
+    entity->prevInCell = -1;
+    entity->nextInCell = hash->cellHeads[cell];
+    if (entity->nextInCell != -1)
+        entities[entity->nextInCell].prevInCell = index;
+    hash->cellHeads[cell] = index;
+
+    float halfExtent = fmaxf(entity->rect.width, entity->rect.height) / 2;
+    if (halfExtent > hash->maxHalfExtent)
+        hash->maxHalfExtent = halfExtent;
+}
+
+void SpatialHashRemove(SpatialHash *hash, WorldEntity *entities, int index)
+{
+    WorldEntity *entity = &entities[index];
+    if (entity->cell == -1)
+        return;
+
+    if (entity->prevInCell != -1)
+        entities[entity->prevInCell].nextInCell = entity->nextInCell;
+    else
+        hash->cellHeads[entity->cell] = entity->nextInCell;
+    if (entity->nextInCell != -1)
+        entities[entity->nextInCell].prevInCell = entity->prevInCell;
+
+    entity->cell = -1;
+    entity->prevInCell = -1;
+    entity->nextInCell = -1;
+}
+
+void SpatialHashMove(SpatialHash *hash, WorldEntity *entities, int index)
+{
+    if (entities[index].cell == EntityCell(hash, &entities[index]))
+        return;
+
+    SpatialHashRemove(hash, entities, index);
+    SpatialHashInsert(hash, entities, index);
+}
+
+int CompareEntityCells(const void *a, const void *b)
+{
+    return ((const WorldEntity *)a)->cell - ((const WorldEntity *)b)->cell;
+}
+
+// Reorders the entities so each cell's members sit next to each other in memory, then relinks the cells
+// in that order. Without it the cell lists follow insertion order and every step of a query is a cache
+// miss on large maps. Entity indices change, so call it only right after a bulk population.
+void SpatialHashCompact(SpatialHash *hash, WorldEntity *entities, int count)
+{
+    qsort(entities, (size_t)count, sizeof(WorldEntity), CompareEntityCells);
+    ClearSpatialHash(hash);
+    for (int i = count - 1; i >= 0; i--)
+        SpatialHashInsert(hash, entities, i);
+}
+
+int SpatialHashQuery(const SpatialHash *hash, const WorldEntity *entities, Rectangle area, int *results, int maxResults)
+{
+    // Entities are filed by center, so widen the search by the largest half extent ever inserted
+    float pad = hash->maxHalfExtent;
+    int minCell = SpatialHashCell(hash, area.x - pad, area.y - pad);
+    int maxCell = SpatialHashCell(hash, area.x + area.width + pad, area.y + area.height + pad);
+    int minX = minCell % hash->cols;
+    int minY = minCell / hash->cols;
+    int maxX = maxCell % hash->cols;
+    int maxY = maxCell / hash->cols;
+
+    int count = 0;
+    for (int cy = minY; cy <= maxY; cy++)
+    {
+        for (int cx = minX; cx <= maxX; cx++)
+        {
+            for (int i = hash->cellHeads[cy * hash->cols + cx]; i != -1; i = entities[i].nextInCell)
+            {
+                if (count < maxResults && CheckCollisionRecs(area, entities[i].rect))
+                    results[count++] = i;
+            }
+        }
+    }
+    return count;
+}
+
+Vector2 ExploreSpawnOrigin(void)
+{
+    return (Vector2){worldWidth / 2 - SCREEN_WIDTH / 2, worldHeight / 2 - SCREEN_HEIGHT / 2};
+}
+
+bool InitWorld(float width, float height, int capacity)
+{
+    worldWidth = width;
+    worldHeight = height;
+    worldEntities = (WorldEntity *)TrackedCalloc(MEM_TAG_WORLD, (size_t)capacity, sizeof(WorldEntity));
+    if (worldEntities == NULL)
+        return false;
+    return InitSpatialHash(&worldHash, width, height, SPATIAL_CELL_SIZE);
+}
+
+void AddWorldEntity(EntityType type, Rectangle rect, int choice)
+{
+    int index = worldEntityCount++;
+    WorldEntity *entity = &worldEntities[index];
+    *entity = (WorldEntity){0};
+    entity->type = type;
+    entity->rect = rect;
+    entity->active = true;
+    entity->choice = choice;
+    entity->line = rand() % (int)(sizeof(npcLines) / sizeof(npcLines[0]));
+    entity->cell = -1;
+    SpatialHashInsert(&worldHash, worldEntities, index);
+}
+
+void PopulateWorld(void)
+{
+    worldEntityCount = 0;
+    ClearSpatialHash(&worldHash);
+
+    // The two stage doors keep the original single-screen layout around the spawn point
+    Vector2 origin = ExploreSpawnOrigin();
+    AddWorldEntity(ENTITY_DOOR, (Rectangle){origin.x + 100, origin.y + 240, 150, 220}, 0);
+    AddWorldEntity(ENTITY_DOOR, (Rectangle){origin.x + SCREEN_WIDTH - 250, origin.y + 240, 150, 220}, 1);
+
+    Rectangle spawnArea = {origin.x, origin.y, SCREEN_WIDTH, SCREEN_HEIGHT};
+    while (worldEntityCount < WORLD_ENTITY_COUNT)
+    {
+        int roll = rand() % 10;
+        EntityType type = (roll < 3) ? ENTITY_DOOR : (roll < 7) ? ENTITY_PICKUP : ENTITY_NPC;
+        Vector2 size = (type == ENTITY_DOOR) ? (Vector2){60, 90} : (type == ENTITY_PICKUP) ? (Vector2){16, 16} : (Vector2){24, 48};
+        Rectangle rect = {floorf(WorldRandomRange(worldWidth - size.x)), floorf(WorldRandomRange(worldHeight - size.y)), size.x, size.y};
+        if (CheckCollisionRecs(rect, spawnArea))
+            continue;
+        AddWorldEntity(type, rect, -1);
+    }
+    SpatialHashCompact(&worldHash, worldEntities, worldEntityCount);
+}
+
+Rectangle CameraViewRect(Camera2D camera)
+{
+    Vector2 topLeft = GetScreenToWorld2D((Vector2){0, 0}, camera);
+    Vector2 bottomRight = GetScreenToWorld2D((Vector2){SCREEN_WIDTH, SCREEN_HEIGHT}, camera);
+    return (Rectangle){topLeft.x, topLeft.y, bottomRight.x - topLeft.x, bottomRight.y - topLeft.y};
+}
+
+void UpdateExploreCamera(void)
+{
+    exploreCamera.offset = (Vector2){SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f};
+    exploreCamera.zoom = 1.0f;
+    exploreCamera.rotation = 0.0f;
+    exploreCamera.target = (Vector2){explorePlayerX + 10, explorePlayerY + 20};
+
+    float halfW = SCREEN_WIDTH / 2.0f;
+    float halfH = SCREEN_HEIGHT / 2.0f;
+    exploreCamera.target.x = fminf(fmaxf(exploreCamera.target.x, halfW), worldWidth - halfW);
+    exploreCamera.target.y = fminf(fmaxf(exploreCamera.target.y, halfH), worldHeight - halfH);
+}
+
+void UpdateWorldNpcs(float delta)
+{
+    // Only NPCs around the camera wander; the rest of the map sleeps
+    Rectangle view = CameraViewRect(exploreCamera);
+    Rectangle active = {view.x - 200, view.y - 200, view.width + 400, view.height + 400};
+    int count = SpatialHashQuery(&worldHash, worldEntities, active, queryResults, MAX_QUERY_RESULTS);
+
+    for (int i = 0; i < count; i++)
+    {
+        int index = queryResults[i];
+        WorldEntity *npc = &worldEntities[index];
+        if (npc->type != ENTITY_NPC)
+            continue;
+
+        npc->wanderTimer -= delta;
+        if (npc->wanderTimer <= 0.0f)
+        {
+            float angle = (float)(rand() % 360) * DEG2RAD;
+            float speed = (rand() % 3 == 0) ? 0.0f : 40.0f;
+            npc->velocity = (Vector2){cosf(angle) * speed, sinf(angle) * speed};
+            npc->wanderTimer = 1.0f + (float)(rand() % 200) / 100.0f;
+        }
+
+        npc->rect.x = fminf(fmaxf(npc->rect.x + npc->velocity.x * delta, 0), worldWidth - npc->rect.width);
+        npc->rect.y = fminf(fmaxf(npc->rect.y + npc->velocity.y * delta, 0), worldHeight - npc->rect.height);
+        SpatialHashMove(&worldHash, worldEntities, index);
+        if ((npc->velocity.x != 0 || npc->velocity.y != 0) && CheckCollisionRecs(view, npc->rect))
+            MarkDirty();
+    }
+}
+
+double BenchSeconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int BenchmarkSpatialHash(void)
+{
+    const int counts[] = {1000, 10000, 100000, 1000000};
+    const int queries = 200000;
+    const float density = 200.0f * 200.0f;
+
+    printf("%10s %14s %14s %14s\n", "entidades", "consultas/s", "linear/s", "movimentos/s");
+    for (int c = 0; c < 4; c++)
+    {
+        int count = counts[c];
+        float side = sqrtf(count * density);
+        SpatialHash hash;
+        WorldEntity *entities = (WorldEntity *)TrackedCalloc(MEM_TAG_WORLD, (size_t)count, sizeof(WorldEntity));
+        if (entities == NULL || !InitSpatialHash(&hash, side, side, SPATIAL_CELL_SIZE))
+            return 1;
+
+        SeedWorldRandom(1234);
+        for (int i = 0; i < count; i++)
+        {
+            entities[i].rect = (Rectangle){floorf(WorldRandomRange(side)), floorf(WorldRandomRange(side)), 24, 48};
+            entities[i].cell = -1;
+            SpatialHashInsert(&hash, entities, i);
+        }
+        SpatialHashCompact(&hash, entities, count);
+
+        long found = 0;
+        double start = BenchSeconds();
+        for (int q = 0; q < queries; q++)
+        {
+            Rectangle area = {floorf(WorldRandomRange(side)), floorf(WorldRandomRange(side)), 120, 120};
+            found += SpatialHashQuery(&hash, entities, area, queryResults, MAX_QUERY_RESULTS);
+        }
+        double hashRate = queries / (BenchSeconds() - start);
+
+        // The linear scan is what UpdateExplore did per door; sample fewer queries so large maps finish
+        int linearQueries = queries / (count / 1000);
+        start = BenchSeconds();
+        for (int q = 0; q < linearQueries; q++)
+        {
+            Rectangle area = {floorf(WorldRandomRange(side)), floorf(WorldRandomRange(side)), 120, 120};
+            for (int i = 0; i < count; i++)
+                found += CheckCollisionRecs(area, entities[i].rect);
+        }
+        double linearRate = linearQueries / (BenchSeconds() - start);
+
+        start = BenchSeconds();
+        for (int i = 0; i < count; i++)
+        {
+            entities[i].rect.x = fminf(fmaxf(entities[i].rect.x + (float)(rand() % 41 - 20), 0), side - 1);
+            entities[i].rect.y = fminf(fmaxf(entities[i].rect.y + (float)(rand() % 41 - 20), 0), side - 1);
+            SpatialHashMove(&hash, entities, i);
+        }
+        double moveRate = count / (BenchSeconds() - start);
+
+        printf("%10d %14.0f %14.0f %14.0f   (%ld)\n", count, hashRate, linearRate, moveRate, found);
+
+        FreeSpatialHash(&hash);
+        TrackedFree(entities);
+    }
+    return 0;
+}
+
+void InitGame(void)
+{
+    MarkDirty();
+    currentState = GAME_STATE_TITLE;
+    currentStage = 0;
+    inventoryCount = 0;
+    itemMessageTimer = 0.0f;
+    lastItemCollected = ITEM_NONE;
+
+    inventoryScroll = 0;
+    inventoryVersion++;
+    for (int i = 0; i < INVENTORY_CAPACITY; i++)
+    {
+        inventory[i] = ITEM_NONE;
+        itemUsed[i] = false;
+    }
+    if (debugInventory)
+        FillDebugInventory();
+
+    player.hp = 120;
+    player.maxHp = 120;
+    boss.hp = 210;
+    boss.maxHp = 210;
+    boss.attack = 22;
+
+    battleState = BATTLE_PLAYER_TURN;
+    selectedItemIndex = 0;
+    playerHasArmor = false;
+    battleMessage = "Batalha contra o Chefe! Escolha seu item.";
+
+    srand((unsigned int)time(NULL));
+    SeedWorldRandom((unsigned int)time(NULL));
+
+    if (worldEntities == NULL)
+    {
+        if (!FileExists(MAP_FILE))
+            GenerateTileMapFile(MAP_FILE, MAP_TILES, MAP_TILES);
+        if (LoadTileMap(&tileMap, MAP_FILE))
+            InitWorld((float)(tileMap.widthTiles * TILE_SIZE), (float)(tileMap.heightTiles * TILE_SIZE), WORLD_ENTITY_COUNT);
+        else
+            InitWorld(WORLD_WIDTH, WORLD_HEIGHT, WORLD_ENTITY_COUNT);
+    }
+    PopulateWorld();
+
+    Vector2 origin = ExploreSpawnOrigin();
+    explorePlayerX = origin.x + SCREEN_WIDTH / 2 - 10;
+    explorePlayerY = origin.y + 420;
+    explorePlayerSpeed = 250.0f;
+    gemsCollected = 0;
+    exploreNotice = NULL;
+    exploreNoticeTimer = 0.0f;
+    UpdateExploreCamera();
+
+    if (!texturesInitialized)
+    {
+        playerTexture = LoadAsset("boss_player/player");
+        bossTexture = LoadAsset("boss_player/boss");
+        titleBackgroundTexture = LoadAsset("cenarios/title_bg");
+        battleBackgroundTexture = LoadAsset("cenarios/battle_bg");
+        escapeEndingBackgroud = LoadAsset("cenarios/escapeEnding");
+        wonEndingBackgroud = LoadAsset("cenarios/wonEnding");
+        loseEndingBackgroud = LoadAsset("cenarios/loseEnding");
+
+        bgStage1 = LoadAsset("cenarios/cenario1");
+        bgStage2 = LoadAsset("cenarios/cenario2");
+        bgStage3 = LoadAsset("cenarios/cenario3");
+        bgStage4 = LoadAsset("cenarios/cenario4");
+        tilesetTexture = LoadAsset("tiles");
+
+        bossAttackTexture = LoadAsset("boss_attack");
+        playerHitTexture = LoadAsset("player_hit");
+        bossHitTexture = LoadAsset("boss_hit");
+        playerAttackTexture = LoadAsset("player_attack");
+
+        bossAttackFrameCount = 1;
+        bossAttackFrameDuration = BOSS_ATTACK_DURATION;
+        if (bossAttackTexture.id != 0 && bossAttackTexture.height > 0)
+        {
+            bossAttackFrameCount = bossAttackTexture.width / bossAttackTexture.height;
+            if (bossAttackFrameCount < 1)
+                bossAttackFrameCount = 1;
+            bossAttackFrameDuration = BOSS_ATTACK_DURATION / (float)bossAttackFrameCount;
+        }
+
+        playerAttackFrameCount = 1;
+        playerAttackFrameDuration = PLAYER_ATTACK_DURATION;
+        if (playerAttackTexture.id != 0 && playerAttackTexture.height > 0)
+        {
+            playerAttackFrameCount = playerAttackTexture.width / playerAttackTexture.height;
+            if (playerAttackFrameCount < 1)
+                playerAttackFrameCount = 1;
+            playerAttackFrameDuration = PLAYER_ATTACK_DURATION / (float)playerAttackFrameCount;
+        }
+
+        texturesInitialized = true;
+    }
+
+    bossIsAttacking = false;
+    bossAttackTimer = 0.0f;
+    bossHurtTimer = 0.0f;
+}
+
+// The tilemap belongs to the render thread, so edits travel with the snapshot
+void QueueTileEdit(int x, int y, unsigned char tile)
+{
+    if (pendingTileEditCount < MAX_TILE_EDITS)
+        pendingTileEdits[pendingTileEditCount++] = (TileEdit){x, y, tile};
+}
+
+void UpdateExplore(void)
+{
+    if (itemMessageTimer > 0)
+    {
+        itemMessageTimer -= frameDelta;
+        if (itemMessageTimer <= 0)
+        {
+            MarkDirty();
+            if (currentStage >= 4)
+            {
+                currentState = GAME_STATE_BATTLE;
+                battleState = BATTLE_PLAYER_TURN;
+            }
+        }
+        return;
+    }
+
+    float delta = frameDelta;
+    float oldX = explorePlayerX;
+    float oldY = explorePlayerY;
+    if (InputDown(KEY_RIGHT) || InputDown(KEY_D))
+        explorePlayerX += explorePlayerSpeed * delta;
+    if (InputDown(KEY_LEFT) || InputDown(KEY_A))
+        explorePlayerX -= explorePlayerSpeed * delta;
+    if (InputDown(KEY_DOWN) || InputDown(KEY_S))
+        explorePlayerY += explorePlayerSpeed * delta;
+    if (InputDown(KEY_UP) || InputDown(KEY_W))
+        explorePlayerY -= explorePlayerSpeed * delta;
+
+    explorePlayerX = fminf(fmaxf(explorePlayerX, 10), worldWidth - 30);
+    explorePlayerY = fminf(fmaxf(explorePlayerY, 20), worldHeight - 50);
+    if (explorePlayerX != oldX || explorePlayerY != oldY)
+    {
+        if (InputPressed(KEY_RIGHT) || InputPressed(KEY_LEFT) || InputPressed(KEY_DOWN) || InputPressed(KEY_UP) ||
+            InputPressed(KEY_D) || InputPressed(KEY_A) || InputPressed(KEY_S) || InputPressed(KEY_W))
+            ReflectInput("movimento");
+        else
+            MarkDirty();
+    }
+    UpdateExploreCamera();
+    UpdateWorldNpcs(delta);
+
+    if (exploreNoticeTimer > 0)
+    {
+        exploreNoticeTimer -= delta;
+        if (exploreNoticeTimer <= 0)
+            MarkDirty();
+    }
+
+    Rectangle playerRect = (Rectangle){explorePlayerX - 5, explorePlayerY - 10, 30, 60};
+    Rectangle talkRect = (Rectangle){playerRect.x - 60, playerRect.y - 60, playerRect.width + 120, playerRect.height + 120};
+    int count = SpatialHashQuery(&worldHash, worldEntities, talkRect, queryResults, MAX_QUERY_RESULTS);
+
+    int chosen = -1;
+    bool lockedDoor = false;
+    int previousNpc = nearbyNpc;
+    nearbyNpc = -1;
+    for (int i = 0; i < count; i++)
+    {
+        int index = queryResults[i];
+        WorldEntity *entity = &worldEntities[index];
+        bool touching = CheckCollisionRecs(playerRect, entity->rect);
+
+        if (entity->type == ENTITY_NPC && nearbyNpc == -1)
+            nearbyNpc = index;
+        else if (entity->type == ENTITY_PICKUP && touching)
+        {
+            entity->active = false;
+            SpatialHashRemove(&worldHash, worldEntities, index);
+            gemsCollected++;
+            MarkDirty();
+            QueueTileEdit((int)(entity->rect.x + entity->rect.width / 2) / TILE_SIZE,
+                          (int)(entity->rect.y + entity->rect.height / 2) / TILE_SIZE, TILE_PATH);
+        }
+        else if (entity->type == ENTITY_DOOR && touching)
+        {
+            if (entity->choice != -1)
+                chosen = entity->choice;
+            else
+                lockedDoor = true;
+        }
+    }
+
+    if (nearbyNpc != previousNpc)
+        MarkDirty();
+
+    if (InputPressed(KEY_ENTER))
+    {
+        if (chosen != -1)
+        {
+            ReflectInput("porta");
+            lastItemCollected = GetItemForChoice(currentStage, chosen);
+            if (!AddInventoryItem(lastItemCollected))
+                TraceLog(LOG_WARNING, "INVENTORY: inventario cheio, %s descartado", GetItemName(lastItemCollected));
+            currentStage++;
+            itemMessageTimer = 2.0f;
+
+            PopulateWorld();
+            Vector2 origin = ExploreSpawnOrigin();
+            explorePlayerX = origin.x + SCREEN_WIDTH / 2 - 10;
+            explorePlayerY = origin.y + 420;
+            nearbyNpc = -1;
+            UpdateExploreCamera();
+        }
+        else if (lockedDoor)
+        {
+            exploreNotice = "A porta está trancada.";
+            exploreNoticeTimer = 1.5f;
+            ReflectInput("porta");
+        }
+    }
+}
+
+void UpdateBattle(void)
+{
+    float delta = frameDelta;
+
+    if (playerIsAttacking)
+    {
+        playerAttackTimer -= delta;
+        if (playerAttackTimer <= 0.0f)
+            playerIsAttacking = false;
+
+        if (playerAttackFrameCount > 1)
+        {
+            playerAttackFrameTime += delta;
+            if (playerAttackFrameTime >= playerAttackFrameDuration)
+            {
+                playerAttackFrameTime -= playerAttackFrameDuration;
+                playerAttackFrame = (playerAttackFrame + 1) % playerAttackFrameCount;
+            }
+        }
+    }
+
+    if (bossIsAttacking)
+    {
+        bossAttackTimer -= delta;
+        if (bossAttackTimer <= 0.0f)
+            bossIsAttacking = false;
+
+        if (bossAttackFrameCount > 1)
+        {
+            bossAttackFrameTime += delta;
+            if (bossAttackFrameTime >= bossAttackFrameDuration)
+            {
+                bossAttackFrameTime -= bossAttackFrameDuration;
+                bossAttackFrame = (bossAttackFrame + 1) % bossAttackFrameCount;
+            }
+        }
+    }
+
+    if (bossHurtTimer > 0.0f)
+        bossHurtTimer -= delta;
+    if (playerHurtTimer > 0.0f)
+        playerHurtTimer -= delta;
+
+    if (boss.hp <= 0)
+    {
+        currentState = GAME_STATE_ENDING_GOOD;
+        return;
+    }
+    if (player.hp <= 0)
+    {
+        currentState = GAME_STATE_ENDING_BAD;
+        return;
+    }
+
+    if (battleState == BATTLE_PLAYER_TURN)
+    {
+        if (InputPressed(KEY_A))
+            ReflectInput("ataque");
+        else if (InputPressed(KEY_ENTER))
+            ReflectInput("item");
+        else if (InputPressed(KEY_RIGHT) || InputPressed(KEY_LEFT) || InputPressed(KEY_UP) || InputPressed(KEY_DOWN))
+            ReflectInput("menu");
+
+        int slots = InventorySlotCount();
+        if (InputPressed(KEY_RIGHT))
+            SelectInventorySlot((selectedItemIndex + 1) % slots);
+        if (InputPressed(KEY_LEFT))
+            SelectInventorySlot((selectedItemIndex - 1 + slots) % slots);
+        if (InputPressed(KEY_DOWN))
+            SelectInventorySlot(selectedItemIndex + INVENTORY_VISIBLE_SLOTS < slots ? selectedItemIndex + INVENTORY_VISIBLE_SLOTS : slots - 1);
+        if (InputPressed(KEY_UP))
+            SelectInventorySlot(selectedItemIndex > INVENTORY_VISIBLE_SLOTS ? selectedItemIndex - INVENTORY_VISIBLE_SLOTS : 0);
+        if (InputPressed(KEY_A))
+            PlayerAttack();
+        if (InputPressed(KEY_ENTER))
+            UseItem(selectedItemIndex);
+    }
+    else if (battleState == BATTLE_BOSS_TURN)
+    {
+        bossTurnTimer -= delta;
+        if (bossTurnTimer <= 0)
+        {
+            BossAttack();
+            battleState = BATTLE_PLAYER_TURN;
+        }
     }
 }
 
 void UpdateTitleScreen(void)
 {
-    if (IsKeyPressed(KEY_ENTER))
+    if (InputPressed(KEY_ENTER))
     {
+        ReflectInput("inicio");
         currentState = GAME_STATE_EXPLORE;
     }
 }
@@ -522,20 +2753,29 @@ void DrawBossSprite(int posX, int posY)
     DrawRectangleLines(posX, posY, 40, 60, (Color){100, 0, 0, 255});
 }
 
-void DrawExplore(void)
+void DrawExplore(const FrameSnapshot *frame)
 {
     Texture2D currentBg = {0};
 
-    if (currentStage == 0)
+    if (frame->stage == 0)
         currentBg = bgStage1;
-    else if (currentStage == 1)
+    else if (frame->stage == 1)
         currentBg = bgStage2;
-    else if (currentStage == 2)
+    else if (frame->stage == 2)
         currentBg = bgStage3;
-    else if (currentStage == 3)
+    else if (frame->stage == 3)
         currentBg = bgStage4;
 
-    if (currentBg.id != 0)
+    if (tileMap.chunks)
+    {
+        Rectangle view = CameraViewRect(frame->camera);
+        PrepareTileMap(&tileMap, view);
+        ClearBackground((Color){20, 20, 40, 255});
+        BeginMode2D(frame->camera);
+        DrawTileMap(&tileMap, view, stageTints[frame->stage < 4 ? frame->stage : 3]);
+        EndMode2D();
+    }
+    else if (currentBg.id != 0)
     {
         DrawTexturePro(currentBg,
                        (Rectangle){0, 0, (float)currentBg.width, (float)currentBg.height},
@@ -549,16 +2789,16 @@ void DrawExplore(void)
         DrawRectangleLines(60, 120, SCREEN_WIDTH - 120, 420, (Color){100, 150, 200, 255});
     }
 
-    if (itemMessageTimer > 0)
+    if (frame->itemMessageTimer > 0)
     {
         DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, (Color){0, 0, 0, 200});
         DrawRectangle(SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 - 100, 600, 200, (Color){50, 50, 100, 255});
         DrawRectangleLines(SCREEN_WIDTH / 2 - 300, SCREEN_HEIGHT / 2 - 100, 600, 200, (Color){100, 200, 255, 255});
 
-        sprintf(messageBuffer, "Voce coletou: %s!", GetItemName(lastItemCollected));
-        int textWidth = MeasureText(messageBuffer, 30);
-        DrawText(messageBuffer, SCREEN_WIDTH / 2 - textWidth / 2, SCREEN_HEIGHT / 2 - 50, 30, (Color){100, 255, 150, 255});
-        DrawText("Carregando proximo cenario...", SCREEN_WIDTH / 2 - 120, SCREEN_HEIGHT / 2 + 40, 18, (Color){150, 150, 200, 255});
+        const char *collected = TextFormat("Você coletou: %s!", GetItemName(frame->lastItemCollected));
+        int textWidth = MeasureGameText(collected, 30);
+        DrawGameText(collected, SCREEN_WIDTH / 2 - textWidth / 2, SCREEN_HEIGHT / 2 - 50, 30, (Color){100, 255, 150, 255});
+        DrawGameText("Carregando próximo cenário...", SCREEN_WIDTH / 2 - 120, SCREEN_HEIGHT / 2 + 40, 18, (Color){150, 150, 200, 255});
         return;
     }
 
@@ -566,62 +2806,275 @@ void DrawExplore(void)
     const char *leftDoorLabel = "Porta A";
     const char *rightDoorLabel = "Porta B";
 
-    switch (currentStage)
+    switch (frame->stage)
     {
     case 0:
-        storyText = "Voce chega aos portoes do Castelo exausto.\nPrecisa recuperar as forcas antes de entrar.";
+        storyText = "Você chega aos portões do Castelo exausto.\nPrecisa recuperar as forças antes de entrar.";
         leftDoorLabel = "Beber da Fonte";
         rightDoorLabel = "Comer Frutas";
         break;
     case 1:
-        storyText = "No arsenal abandonado, voce ve duas armas.\nQual estilo de combate voce prefere?";
+        storyText = "No arsenal abandonado, você vê duas armas.\nQual estilo de combate você prefere?";
         leftDoorLabel = "Espada Antiga";
         rightDoorLabel = "Bomba Caseira";
         break;
     case 2:
-        storyText = "Um esqueleto segura dois itens valiosos.\nVoce prioriza protecao ou tenta subornar o chefe?";
+        storyText = "Um esqueleto segura dois itens valiosos.\nVocê prioriza proteção ou tenta subornar o chefe?";
         leftDoorLabel = "Armadura Leve";
         rightDoorLabel = "Bolsa de Ouro";
         break;
     case 3:
-        storyText = "A porta do trono esta a frente. O medo gela a espinha.\nUltima chance de curar ferimentos.";
+        storyText = "A porta do trono está à frente. O medo gela a espinha.\nÚltima chance de curar ferimentos.";
         leftDoorLabel = "Usar Curativos";
-        rightDoorLabel = "Tonico Vital";
+        rightDoorLabel = "Tônico Vital";
         break;
     }
 
-    DrawText(storyText, 82, 62, 22, BLACK);
-    DrawText(storyText, 80, 60, 22, WHITE);
+    BeginMode2D(frame->camera);
+    DrawRectangleLines(0, 0, (int)worldWidth, (int)worldHeight, (Color){100, 150, 200, 255});
+
+    for (int i = 0; i < frame->visibleCount; i++)
+    {
+        const VisibleEntity *entity = &frame->visible[i];
+        Rectangle r = entity->rect;
+        switch (entity->type)
+        {
+        case ENTITY_DOOR:
+            if (entity->choice != -1)
+            {
+                const char *label = (entity->choice == 0) ? leftDoorLabel : rightDoorLabel;
+                DrawRectangleRec(r, (Color){255, 255, 255, 30});
+                DrawRectangleLines((int)r.x, (int)r.y, (int)r.width, (int)r.height, YELLOW);
+                DrawGameText(label, (int)r.x + 12, (int)r.y + 92, 16, BLACK);
+                DrawGameText(label, (int)r.x + 10, (int)r.y + 90, 16, WHITE);
+            }
+            else
+            {
+                DrawRectangleRec(r, (Color){90, 60, 30, 220});
+                DrawRectangleLines((int)r.x, (int)r.y, (int)r.width, (int)r.height, DARKBROWN);
+            }
+            break;
+        case ENTITY_PICKUP:
+            DrawCircle((int)(r.x + r.width / 2), (int)(r.y + r.height / 2), r.width / 2, GOLD);
+            break;
+        case ENTITY_NPC:
+            DrawCircle((int)(r.x + r.width / 2), (int)r.y + 8, 8, (Color){255, 200, 150, 255});
+            DrawRectangle((int)r.x, (int)r.y + 16, (int)r.width, (int)r.height - 16, (Color){60, 160, 80, 255});
+            break;
+        }
+    }
+    // Door labels belong to the entity layer, below the player and the NPC balloon
+    FlushGameText();
+
+    if (texturesInitialized && playerTexture.id != 0)
+    {
+        Rectangle src = {0, 0, (float)playerTexture.width, (float)playerTexture.height};
+        Vector2 origin = {playerTexture.width / 2.0f, playerTexture.height / 2.0f};
+        Rectangle dest = {frame->explorePlayer.x + 10, frame->explorePlayer.y + playerTexture.height / 2.0f, (float)playerTexture.width, (float)playerTexture.height};
+        DrawTexturePro(playerTexture, src, dest, origin, 0.0f, WHITE);
+    }
+    else
+    {
+        DrawPlayerSprite((int)frame->explorePlayer.x, (int)frame->explorePlayer.y);
+    }
+
+    if (frame->npcLine)
+    {
+        Rectangle npc = frame->npcRect;
+        int lineWidth = MeasureGameText(frame->npcLine, 16);
+        int lineX = (int)(npc.x + npc.width / 2) - lineWidth / 2;
+        DrawRectangle(lineX - 6, (int)npc.y - 30, lineWidth + 12, 24, (Color){0, 0, 0, 180});
+        DrawGameText(frame->npcLine, lineX, (int)npc.y - 26, 16, WHITE);
+    }
+    FlushGameText();
+    EndMode2D();
+
+    DrawGameText(storyText, 82, 62, 22, BLACK);
+    DrawGameText(storyText, 80, 60, 22, WHITE);
+
+    DrawGameText(TextFormat("Gemas: %d", frame->gemsCollected), SCREEN_WIDTH - 140, 22, 20, GOLD);
+    if (frame->exploreNotice)
+        DrawGameText(frame->exploreNotice, SCREEN_WIDTH / 2 - MeasureGameText(frame->exploreNotice, 20) / 2, SCREEN_HEIGHT - 80, 20, ORANGE);
+
+    DrawGameText("Use SETAS ou WASD e [ENTER] na porta.", 82, SCREEN_HEIGHT - 38, 16, BLACK);
+    DrawGameText("Use SETAS ou WASD e [ENTER] na porta.", 80, SCREEN_HEIGHT - 40, 16, WHITE);
+}
+
+#define HUD_BAR_MARGIN 20
+#define HUD_BAR_W 300
+#define HUD_BAR_H 25
+#define HUD_SLOT_W 180
+#define HUD_SLOT_STEP 200
+
+const char *InventorySlotLabel(const FrameSnapshot *frame, int slot)
+{
+    ItemType item = frame->inventory[slot];
+    return (item == ITEM_SWORD || item == ITEM_ARMOR) ? "Vazio" : GetItemName(item);
+}
+
+int HudSlotCount(const FrameSnapshot *frame)
+{
+    return (frame->inventoryCount > INVENTORY_VISIBLE_SLOTS) ? frame->inventoryCount : INVENTORY_VISIBLE_SLOTS;
+}
+
+// Models rlgl, which starts a new draw call whenever the primitive mode or texture changes between
+// consecutive calls; the count is an estimate since rlgl does not expose its real draw counter
+void CountHudPrimitive(int batchKind)
+{
+    hudPrimitives++;
+    if (batchKind != hudLastBatchKind)
+        hudDrawCalls++;
+    hudLastBatchKind = batchKind;
+}
+
+// The original immediate-mode HUD, kept behind F5 for comparison
+void DrawBattleHudLegacy(const FrameSnapshot *frame)
+{
+    enum { FILL, LINES, TEXT };
+    int textKind = UiBatched() ? TEXT : FILL;
+    hudDrawCalls = 0;
+    hudPrimitives = 0;
+    hudLastBatchKind = -1;
+
+    DrawGameText("Player (você)", HUD_BAR_MARGIN, HUD_BAR_MARGIN, 22, (Color){150, 200, 255, 255});
+    DrawRectangle(HUD_BAR_MARGIN, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H, (Color){50, 50, 80, 255});
+    DrawRectangle(HUD_BAR_MARGIN, HUD_BAR_MARGIN + 35, (int)(HUD_BAR_W * ((float)frame->player.hp / frame->player.maxHp)), HUD_BAR_H, (Color){50, 200, 100, 255});
+    DrawRectangleLines(HUD_BAR_MARGIN, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H, WHITE);
+    DrawGameText(TextFormat("HP: %d / %d", frame->player.hp, frame->player.maxHp), HUD_BAR_MARGIN + 80, HUD_BAR_MARGIN + 37, 20, WHITE);
+    CountHudPrimitive(FILL);
+    CountHudPrimitive(FILL);
+    CountHudPrimitive(LINES);
+
+    int bossBarX = SCREEN_WIDTH - HUD_BAR_W - HUD_BAR_MARGIN;
+    DrawGameText("Boss", bossBarX, HUD_BAR_MARGIN, 22, (Color){255, 100, 100, 255});
+    DrawRectangle(bossBarX, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H, (Color){50, 50, 80, 255});
+    DrawRectangle(bossBarX, HUD_BAR_MARGIN + 35, (int)(HUD_BAR_W * ((float)frame->boss.hp / frame->boss.maxHp)), HUD_BAR_H, (Color){255, 50, 50, 255});
+    DrawRectangleLines(bossBarX, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H, WHITE);
+    DrawGameText(TextFormat("HP: %d / %d", frame->boss.hp, frame->boss.maxHp), bossBarX + 80, HUD_BAR_MARGIN + 37, 20, WHITE);
+    CountHudPrimitive(FILL);
+    CountHudPrimitive(FILL);
+    CountHudPrimitive(LINES);
+
+    int itemPosX = 20;
+    int lastSlot = frame->inventoryScroll + INVENTORY_VISIBLE_SLOTS;
+    for (int i = frame->inventoryScroll; i < lastSlot && i < HudSlotCount(frame); i++)
+    {
+        Color bgColor = (i == frame->selectedItemIndex) ? (Color){100, 200, 255, 255} : (Color){50, 50, 100, 255};
+        DrawRectangle(itemPosX, SCREEN_HEIGHT - 70, HUD_SLOT_W, 40, bgColor);
+        DrawRectangleLines(itemPosX, SCREEN_HEIGHT - 70, HUD_SLOT_W, 40, LIGHTGRAY);
+        CountHudPrimitive(FILL);
+        CountHudPrimitive(LINES);
+
+        Color txtColor = frame->itemUsed[i] ? GRAY : (i == frame->selectedItemIndex ? BLACK : WHITE);
+        DrawGameText(InventorySlotLabel(frame, i), itemPosX + 5, SCREEN_HEIGHT - 58, 12, txtColor);
+        if (textKind == FILL)
+            CountHudPrimitive(FILL);
+        itemPosX += HUD_SLOT_STEP;
+    }
+    if (HudSlotCount(frame) > INVENTORY_VISIBLE_SLOTS)
+        DrawGameText(TextFormat("< %d / %d >  [SETAS]", frame->selectedItemIndex + 1, HudSlotCount(frame)), 20, SCREEN_HEIGHT - 92, 14, LIGHTGRAY);
+
+    DrawRectangle(SCREEN_WIDTH - 150, SCREEN_HEIGHT - 85, 130, 45, RED);
+    DrawRectangleLines(SCREEN_WIDTH - 150, SCREEN_HEIGHT - 85, 130, 45, MAROON);
+    DrawGameText("ATACAR [A]", SCREEN_WIDTH - 140, SCREEN_HEIGHT - 75, 16, WHITE);
+    CountHudPrimitive(FILL);
+    CountHudPrimitive(LINES);
+
+    if (frame->battleMessage[0])
+    {
+        DrawGameText(frame->battleMessage, SCREEN_WIDTH / 2 - MeasureGameText(frame->battleMessage, 20) / 2, 100, 20, YELLOW);
+    }
+
+    // Queued SDF text lands in one extra batch when the frame's text is flushed
+    if (textKind == TEXT)
+    {
+        hudLastBatchKind = -1;
+        CountHudPrimitive(TEXT);
+    }
+}
 
-    DrawRectangleRec(doorLeftRect, (Color){255, 255, 255, 30});
-    DrawRectangleLines((int)doorLeftRect.x, (int)doorLeftRect.y, (int)doorLeftRect.width, (int)doorLeftRect.height, YELLOW);
+unsigned long long BattleHudKey(const FrameSnapshot *frame)
+{
+    unsigned long long key = 14695981039346656037ull;
+    key = HashBytes(key, &frame->player, sizeof(frame->player));
+    key = HashBytes(key, &frame->boss, sizeof(frame->boss));
+    key = HashBytes(key, &frame->selectedItemIndex, sizeof(frame->selectedItemIndex));
+    key = HashBytes(key, &frame->inventoryScroll, sizeof(frame->inventoryScroll));
+    key = HashBytes(key, &frame->inventoryVersion, sizeof(frame->inventoryVersion));
+    return HashBytes(key, frame->battleMessage, strlen(frame->battleMessage));
+}
 
-    DrawText(leftDoorLabel, (int)doorLeftRect.x + 12, (int)doorLeftRect.y + 92, 16, BLACK);
-    DrawText(leftDoorLabel, (int)doorLeftRect.x + 10, (int)doorLeftRect.y + 90, 16, WHITE);
+void BuildBattleHud(UiLayer *ui, const FrameSnapshot *frame)
+{
+    Rectangle playerBar = {HUD_BAR_MARGIN, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H};
+    UiText(ui, "Player (você)", HUD_BAR_MARGIN, HUD_BAR_MARGIN, 22, (Color){150, 200, 255, 255});
+    UiRect(ui, playerBar, (Color){50, 50, 80, 255});
+    UiRect(ui, (Rectangle){playerBar.x, playerBar.y, (int)(HUD_BAR_W * ((float)frame->player.hp / frame->player.maxHp)), HUD_BAR_H}, (Color){50, 200, 100, 255});
+    UiRectLines(ui, playerBar, WHITE);
+    UiText(ui, TextFormat("HP: %d / %d", frame->player.hp, frame->player.maxHp), HUD_BAR_MARGIN + 80, HUD_BAR_MARGIN + 37, 20, WHITE);
+
+    Rectangle bossBar = {SCREEN_WIDTH - HUD_BAR_W - HUD_BAR_MARGIN, HUD_BAR_MARGIN + 35, HUD_BAR_W, HUD_BAR_H};
+    UiText(ui, "Boss", (int)bossBar.x, HUD_BAR_MARGIN, 22, (Color){255, 100, 100, 255});
+    UiRect(ui, bossBar, (Color){50, 50, 80, 255});
+    UiRect(ui, (Rectangle){bossBar.x, bossBar.y, (int)(HUD_BAR_W * ((float)frame->boss.hp / frame->boss.maxHp)), HUD_BAR_H}, (Color){255, 50, 50, 255});
+    UiRectLines(ui, bossBar, WHITE);
+    UiText(ui, TextFormat("HP: %d / %d", frame->boss.hp, frame->boss.maxHp), (int)bossBar.x + 80, HUD_BAR_MARGIN + 37, 20, WHITE);
+
+    // Only the slots inside the scroll window are emitted, however large the inventory is
+    int slotCount = HudSlotCount(frame);
+    int itemPosX = 20;
+    for (int i = frame->inventoryScroll; i < frame->inventoryScroll + INVENTORY_VISIBLE_SLOTS && i < slotCount; i++)
+    {
+        Rectangle slot = {(float)itemPosX, SCREEN_HEIGHT - 70, HUD_SLOT_W, 40};
+        bool selected = (i == frame->selectedItemIndex);
+        UiRect(ui, slot, selected ? (Color){100, 200, 255, 255} : (Color){50, 50, 100, 255});
+        UiRectLines(ui, slot, LIGHTGRAY);
+        UiText(ui, InventorySlotLabel(frame, i), itemPosX + 5, SCREEN_HEIGHT - 58, 12, frame->itemUsed[i] ? GRAY : (selected ? BLACK : WHITE));
+        itemPosX += HUD_SLOT_STEP;
+    }
+    if (slotCount > INVENTORY_VISIBLE_SLOTS)
+    {
+        float track = INVENTORY_VISIBLE_SLOTS * HUD_SLOT_STEP - 20.0f;
+        UiRect(ui, (Rectangle){20, SCREEN_HEIGHT - 26, track, 4}, (Color){50, 50, 80, 255});
+        UiRect(ui, (Rectangle){20 + track * frame->inventoryScroll / slotCount, SCREEN_HEIGHT - 26, track * INVENTORY_VISIBLE_SLOTS / slotCount + 2, 4}, LIGHTGRAY);
+        UiText(ui, TextFormat("< %d / %d >  [SETAS]", frame->selectedItemIndex + 1, slotCount), 20, SCREEN_HEIGHT - 92, 14, LIGHTGRAY);
+    }
 
-    DrawRectangleRec(doorRightRect, (Color){255, 255, 255, 30});
-    DrawRectangleLines((int)doorRightRect.x, (int)doorRightRect.y, (int)doorRightRect.width, (int)doorRightRect.height, YELLOW);
+    Rectangle attack = {SCREEN_WIDTH - 150, SCREEN_HEIGHT - 85, 130, 45};
+    UiRect(ui, attack, RED);
+    UiRectLines(ui, attack, MAROON);
+    UiText(ui, "ATACAR [A]", SCREEN_WIDTH - 140, SCREEN_HEIGHT - 75, 16, WHITE);
 
-    DrawText(rightDoorLabel, (int)doorRightRect.x + 12, (int)doorRightRect.y + 92, 16, BLACK);
-    DrawText(rightDoorLabel, (int)doorRightRect.x + 10, (int)doorRightRect.y + 90, 16, WHITE);
+    if (frame->battleMessage[0])
+        UiText(ui, frame->battleMessage, SCREEN_WIDTH / 2 - MeasureGameText(frame->battleMessage, 20) / 2, 100, 20, YELLOW);
+}
 
-    if (texturesInitialized && playerTexture.id != 0)
+void DrawBattleHud(const FrameSnapshot *frame)
+{
+    double start = GetTime();
+    if (useLegacyHud)
     {
-        Rectangle src = {0, 0, (float)playerTexture.width, (float)playerTexture.height};
-        Vector2 origin = {playerTexture.width / 2.0f, playerTexture.height / 2.0f};
-        Rectangle dest = {explorePlayerX + 10, explorePlayerY + playerTexture.height / 2.0f, (float)playerTexture.width, (float)playerTexture.height};
-        DrawTexturePro(playerTexture, src, dest, origin, 0.0f, WHITE);
+        DrawBattleHudLegacy(frame);
     }
     else
     {
-        DrawPlayerSprite((int)explorePlayerX, (int)explorePlayerY);
+        if (UiBegin(&battleHud, BattleHudKey(frame)))
+        {
+            BuildBattleHud(&battleHud, frame);
+            UiEnd(&battleHud);
+        }
+        else
+        {
+            hudCacheHits++;
+        }
+        UiDraw(&battleHud);
+        hudPrimitives = UiBatched() ? battleHud.quadCount : battleHud.commandCount;
     }
-
-    DrawText("Use SETAS ou A/D e [ENTER] na porta.", 82, SCREEN_HEIGHT - 38, 16, BLACK);
-    DrawText("Use SETAS ou A/D e [ENTER] na porta.", 80, SCREEN_HEIGHT - 40, 16, WHITE);
+    hudFrames++;
+    hudCpuAverage = hudCpuAverage * 0.9 + (GetTime() - start) * 0.1;
 }
 
-void DrawBattle(void)
+void DrawBattle(const FrameSnapshot *frame)
 {
     if (battleBackgroundTexture.id != 0)
     {
@@ -633,47 +3086,30 @@ void DrawBattle(void)
         ClearBackground((Color){30, 30, 50, 255});
     }
 
-    const int BAR_MARGIN = 20;
-    const int BAR_W = 300;
-    const int BAR_H = 25;
-
-    DrawText("Player (voce)", BAR_MARGIN, BAR_MARGIN, 22, (Color){150, 200, 255, 255});
-    DrawRectangle(BAR_MARGIN, BAR_MARGIN + 35, BAR_W, BAR_H, (Color){50, 50, 80, 255});
-    DrawRectangle(BAR_MARGIN, BAR_MARGIN + 35, (int)(BAR_W * ((float)player.hp / player.maxHp)), BAR_H, (Color){50, 200, 100, 255});
-    DrawRectangleLines(BAR_MARGIN, BAR_MARGIN + 35, BAR_W, BAR_H, WHITE);
-    DrawText(TextFormat("HP: %d / %d", player.hp, player.maxHp), BAR_MARGIN + 80, BAR_MARGIN + 37, 20, WHITE);
-
-    int bossBarX = SCREEN_WIDTH - BAR_W - BAR_MARGIN;
-    DrawText("Boss", bossBarX, BAR_MARGIN, 22, (Color){255, 100, 100, 255});
-    DrawRectangle(bossBarX, BAR_MARGIN + 35, BAR_W, BAR_H, (Color){50, 50, 80, 255});
-    DrawRectangle(bossBarX, BAR_MARGIN + 35, (int)(BAR_W * ((float)boss.hp / boss.maxHp)), BAR_H, (Color){255, 50, 50, 255});
-    DrawRectangleLines(bossBarX, BAR_MARGIN + 35, BAR_W, BAR_H, WHITE);
-    DrawText(TextFormat("HP: %d / %d", boss.hp, boss.maxHp), bossBarX + 80, BAR_MARGIN + 37, 20, WHITE);
-
     const float GROUND_Y = 480.0f;
     Vector2 posB = {SCREEN_WIDTH - 250.0f, GROUND_Y};
     float bossOffX = 0;
-    if (bossIsAttacking)
-        bossOffX = -((posB.x - 550.0f) * sinf((1.0f - bossAttackTimer / BOSS_ATTACK_DURATION) * 3.14f));
+    if (frame->bossIsAttacking)
+        bossOffX = -((posB.x - 550.0f) * sinf((1.0f - frame->bossAttackTimer / BOSS_ATTACK_DURATION) * 3.14f));
 
-    float bossAlpha = (bossHurtTimer > 0 && ((int)(bossHurtTimer * 30) % 2 == 0)) ? 0.5f : 1.0f;
+    float bossAlpha = (frame->bossHurtTimer > 0 && ((int)(frame->bossHurtTimer * 30) % 2 == 0)) ? 0.5f : 1.0f;
     Color bossTint = Fade(WHITE, bossAlpha);
 
     if (texturesInitialized && bossTexture.id != 0)
     {
         Texture2D tex = bossTexture;
-        if (bossIsAttacking && bossAttackTexture.id != 0)
+        if (frame->bossIsAttacking && bossAttackTexture.id != 0)
             tex = bossAttackTexture;
 
         float w = (float)tex.width;
-        if (bossIsAttacking && bossAttackFrameCount > 1)
+        if (frame->bossIsAttacking && bossAttackFrameCount > 1)
             w /= bossAttackFrameCount;
 
-        Rectangle src = {bossIsAttacking ? bossAttackFrame * w : 0, 0, w, (float)tex.height};
+        Rectangle src = {frame->bossIsAttacking ? frame->bossAttackFrame * w : 0, 0, w, (float)tex.height};
         Vector2 origin = {w / 2, tex.height / 2.0f};
         DrawTexturePro(tex, src, (Rectangle){posB.x + bossOffX, posB.y - tex.height / 2.0f, w, (float)tex.height}, origin, 0, bossTint);
 
-        if (bossHurtTimer > 0 && bossHitTexture.id != 0)
+        if (frame->bossHurtTimer > 0 && bossHitTexture.id != 0)
             DrawTexturePro(bossHitTexture, (Rectangle){0, 0, (float)bossHitTexture.width, (float)bossHitTexture.height},
                            (Rectangle){posB.x + bossOffX, posB.y - tex.height / 2.0f, (float)bossHitTexture.width, (float)bossHitTexture.height}, origin, 0, WHITE);
     }
@@ -684,27 +3120,27 @@ void DrawBattle(void)
 
     int baseX = 250;
     float atkOffX = 0;
-    if (playerIsAttacking)
-        atkOffX = (450.0f - baseX) * sinf((1.0f - playerAttackTimer / PLAYER_ATTACK_DURATION) * 3.14f);
+    if (frame->playerIsAttacking)
+        atkOffX = (450.0f - baseX) * sinf((1.0f - frame->playerAttackTimer / PLAYER_ATTACK_DURATION) * 3.14f);
 
-    float playerAlpha = (playerHurtTimer > 0 && ((int)(playerHurtTimer * 30) % 2 == 0)) ? 0.5f : 1.0f;
+    float playerAlpha = (frame->playerHurtTimer > 0 && ((int)(frame->playerHurtTimer * 30) % 2 == 0)) ? 0.5f : 1.0f;
     Color playerTint = Fade(WHITE, playerAlpha);
 
     if (texturesInitialized && playerTexture.id != 0)
     {
         Texture2D tex = playerTexture;
-        if (playerIsAttacking && playerAttackTexture.id != 0)
+        if (frame->playerIsAttacking && playerAttackTexture.id != 0)
             tex = playerAttackTexture;
 
         float w = (float)tex.width;
-        if (playerIsAttacking && playerAttackFrameCount > 1)
+        if (frame->playerIsAttacking && playerAttackFrameCount > 1)
             w /= playerAttackFrameCount;
 
-        Rectangle src = {playerIsAttacking ? playerAttackFrame * w : 0, 0, w, (float)tex.height};
+        Rectangle src = {frame->playerIsAttacking ? frame->playerAttackFrame * w : 0, 0, w, (float)tex.height};
         Vector2 origin = {w / 2, tex.height / 2.0f};
         DrawTexturePro(tex, src, (Rectangle){baseX + atkOffX, GROUND_Y - tex.height / 2.0f, w, (float)tex.height}, origin, 0, playerTint);
 
-        if (playerHurtTimer > 0 && playerHitTexture.id != 0)
+        if (frame->playerHurtTimer > 0 && playerHitTexture.id != 0)
             DrawTexturePro(playerHitTexture, (Rectangle){0, 0, (float)playerHitTexture.width, (float)playerHitTexture.height},
                            (Rectangle){baseX + atkOffX, GROUND_Y - tex.height / 2.0f, (float)playerHitTexture.width, (float)playerHitTexture.height}, origin, 0, WHITE);
     }
@@ -713,27 +3149,7 @@ void DrawBattle(void)
         DrawPlayerSprite(baseX + (int)atkOffX - 10, (int)GROUND_Y - 60);
     }
 
-    int itemPosX = 20;
-    for (int i = 0; i < INVENTORY_SIZE; i++)
-    {
-        Color bgColor = (i == selectedItemIndex) ? (Color){100, 200, 255, 255} : (Color){50, 50, 100, 255};
-        DrawRectangle(itemPosX, SCREEN_HEIGHT - 70, 180, 40, bgColor);
-        DrawRectangleLines(itemPosX, SCREEN_HEIGHT - 70, 180, 40, LIGHTGRAY);
-
-        Color txtColor = itemUsed[i] ? GRAY : (i == selectedItemIndex ? BLACK : WHITE);
-        const char *name = (inventory[i] == ITEM_SWORD || inventory[i] == ITEM_ARMOR) ? "Vazio" : GetItemName(inventory[i]);
-        DrawText(name, itemPosX + 5, SCREEN_HEIGHT - 58, 12, txtColor);
-        itemPosX += 200;
-    }
-
-    DrawRectangle(SCREEN_WIDTH - 150, SCREEN_HEIGHT - 85, 130, 45, RED);
-    DrawRectangleLines(SCREEN_WIDTH - 150, SCREEN_HEIGHT - 85, 130, 45, MAROON);
-    DrawText("ATACAR [A]", SCREEN_WIDTH - 140, SCREEN_HEIGHT - 75, 16, WHITE);
-
-    if (battleMessage)
-    {
-        DrawText(battleMessage, SCREEN_WIDTH / 2 - MeasureText(battleMessage, 20) / 2, 100, 20, YELLOW);
-    }
+    DrawBattleHud(frame);
 }
 
 void DrawEnding(bool playerWon)
@@ -756,11 +3172,11 @@ void DrawEnding(bool playerWon)
         ClearBackground((Color){10, 10, 30, 255});
     }
 
-    const char *title = playerWon ? "VITORIA!" : "GAME OVER";
+    const char *title = playerWon ? "VITÓRIA!" : "GAME OVER";
     Color col = playerWon ? GREEN : RED;
-    DrawText(title, SCREEN_WIDTH / 2 - MeasureText(title, 60) / 2, 100, 60, col);
+    DrawGameText(title, SCREEN_WIDTH / 2 - MeasureGameText(title, 60) / 2, 100, 60, col);
     const char *msg = "Pressione [ENTER] para jogar novamente.";
-    DrawText(msg, SCREEN_WIDTH / 2 - MeasureText(msg, 20) / 2, 630, 20, WHITE);
+    DrawGameText(msg, SCREEN_WIDTH / 2 - MeasureGameText(msg, 20) / 2, 630, 20, WHITE);
 }
 
 void DrawEscapeEnding(void)
@@ -774,13 +3190,13 @@ void DrawEscapeEnding(void)
     {
         ClearBackground((Color){10, 10, 30, 255});
     }
-    DrawText("FUGA!", SCREEN_WIDTH / 2 - MeasureText("FUGA!", 60) / 2, 100, 60, ORANGE);
-    DrawText("Voce fugiu do boss com sucesso.", SCREEN_WIDTH / 2 - 100, 160, 20, WHITE);
+    DrawGameText("FUGA!", SCREEN_WIDTH / 2 - MeasureGameText("FUGA!", 60) / 2, 100, 60, ORANGE);
+    DrawGameText("Você fugiu do boss com sucesso.", SCREEN_WIDTH / 2 - 100, 160, 20, WHITE);
     const char *msg = "Pressione [ENTER] para jogar novamente.";
-    DrawText(msg, SCREEN_WIDTH / 2 - MeasureText(msg, 20) / 2, 633, 20, WHITE);
+    DrawGameText(msg, SCREEN_WIDTH / 2 - MeasureGameText(msg, 20) / 2, 633, 20, WHITE);
 }
 
-void DrawTitleScreen(void)
+void DrawTitleScreen(const FrameSnapshot *frame)
 {
     if (titleBackgroundTexture.id != 0)
     {
@@ -792,59 +3208,744 @@ void DrawTitleScreen(void)
         ClearBackground((Color){10, 10, 30, 255});
     }
 
-    DrawText("Rush RPG", SCREEN_WIDTH / 2 - MeasureText("RushRPG", 80) / 2, 100, 80, GOLD);
+    DrawGameText("Rush RPG", SCREEN_WIDTH / 2 - MeasureGameText("RushRPG", 80) / 2, 100, 80, GOLD);
 
-    if (((int)(GetTime() * 2) % 2) == 0)
+    if (frame->titlePhase == 0)
     {
-        DrawText("Pressione [ENTER] para comecar", SCREEN_WIDTH / 2 - MeasureText("Pressione [ENTER] para comecar", 30) / 2, SCREEN_HEIGHT - 100, 30, GREEN);
+        DrawGameText("Pressione [ENTER] para começar", SCREEN_WIDTH / 2 - MeasureGameText("Pressione [ENTER] para começar", 30) / 2, SCREEN_HEIGHT - 100, 30, GREEN);
     }
 
     const char *students[] = {"Lucas Del Pozo", "Lucas Sassi de Souza", "Eduardo Parize", "Vinicius Ribas Bida"};
     int namesY = SCREEN_HEIGHT - 180;
+    FlushGameText();
     DrawRectangle(SCREEN_WIDTH - 250, namesY - 10, 240, 150, (Color){0, 0, 0, 150});
-    DrawText("Desenvolvido por:", SCREEN_WIDTH - 240, namesY, 12, WHITE);
+    DrawGameText("Desenvolvido por:", SCREEN_WIDTH - 240, namesY, 12, WHITE);
     for (int i = 0; i < 4; i++)
-        DrawText(students[i], SCREEN_WIDTH - 240, namesY + 30 + (i * 20), 10, LIGHTGRAY);
+        DrawGameText(students[i], SCREEN_WIDTH - 240, namesY + 30 + (i * 20), 10, LIGHTGRAY);
+}
+
+bool BattleAnimating(void)
+{
+    return playerIsAttacking || bossIsAttacking || playerHurtTimer > 0 || bossHurtTimer > 0;
+}
+
+// States report changes that happen without input, the rest is flagged by MarkDirty in the updates.
+// Called once per snapshot: the battle also redraws on the step its animations end, so the last
+// attack or blink frame is replaced by the settled pose.
+bool StateNeedsRedraw(void)
+{
+    bool wasAnimating = battleWasAnimating;
+    battleWasAnimating = (currentState == GAME_STATE_BATTLE) && BattleAnimating();
+
+    switch (currentState)
+    {
+    case GAME_STATE_TITLE:
+        return ((int)(simInput.time * 2) % 2) != lastTitlePhase;
+    case GAME_STATE_BATTLE:
+        return battleWasAnimating || wasAnimating;
+    default:
+        return false;
+    }
+}
+
+// Seconds until the current state changes on its own, or -1 when only input can change it
+double IdleWakeDelay(void)
+{
+    switch (currentState)
+    {
+    case GAME_STATE_TITLE:
+        return 0.5 - fmod(simInput.time, 0.5);
+    case GAME_STATE_EXPLORE:
+        return IDLE_POLL_INTERVAL;
+    case GAME_STATE_BATTLE:
+        if (BattleAnimating())
+            return IDLE_POLL_INTERVAL;
+        return (battleState == BATTLE_BOSS_TURN) ? bossTurnTimer : -1.0;
+    default:
+        return -1.0;
+    }
+}
+
+// raylib only blocks in PollInputEvents without a timeout, and dispatching events ourselves with
+// glfwWaitEventsTimeout would bypass its key bookkeeping (the press lands before the previous-state
+// copy and is lost). Instead this thread posts an empty GLFW event when the armed deadline passes.
+void *IdleWakerThread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&idleWakerMutex);
+    while (!idleWakerQuit)
+    {
+        if (!idleWakerArmed)
+        {
+            pthread_cond_wait(&idleWakerCond, &idleWakerMutex);
+            continue;
+        }
+        if (pthread_cond_timedwait(&idleWakerCond, &idleWakerMutex, &idleWakeAt) == ETIMEDOUT && idleWakerArmed)
+        {
+            idleWakerArmed = false;
+            glfwPostEmptyEvent();
+        }
+    }
+    pthread_mutex_unlock(&idleWakerMutex);
+    return NULL;
+}
+
+void StartIdleWaker(void)
+{
+    idleWakerQuit = false;
+    idleWakerRunning = pthread_create(&idleWakerThread, NULL, IdleWakerThread, NULL) == 0;
+    if (!idleWakerRunning)
+        TraceLog(LOG_WARNING, "PACING: falha ao criar a thread de espera, acordando a cada quadro");
+}
+
+void StopIdleWaker(void)
+{
+    if (!idleWakerRunning)
+        return;
+    pthread_mutex_lock(&idleWakerMutex);
+    idleWakerQuit = true;
+    pthread_cond_signal(&idleWakerCond);
+    pthread_mutex_unlock(&idleWakerMutex);
+    pthread_join(idleWakerThread, NULL);
+    idleWakerRunning = false;
+}
+
+// Negative waits disarm the deadline
+void ArmIdleWaker(double wait)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long nanos = now.tv_nsec + (long long)(fmax(wait, 0.0) * 1e9);
+
+    pthread_mutex_lock(&idleWakerMutex);
+    idleWakeAt.tv_sec = now.tv_sec + (time_t)(nanos / 1000000000LL);
+    idleWakeAt.tv_nsec = (long)(nanos % 1000000000LL);
+    idleWakerArmed = wait >= 0;
+    pthread_cond_signal(&idleWakerCond);
+    pthread_mutex_unlock(&idleWakerMutex);
+}
+
+// Sleeps until input arrives or, for wait >= 0, until the state's next change is due
+void IdleWait(double wait)
+{
+    if (wait >= 0 && !idleWakerRunning)
+    {
+        WaitTime(fmin(fmax(wait, 0.001), IDLE_POLL_INTERVAL));
+        PollInputEvents();
+        return;
+    }
+
+    if (idleWakerRunning)
+        ArmIdleWaker(wait >= 0 ? fmax(wait, 0.001) : -1.0);
+    EnableEventWaiting();
+    PollInputEvents();
+    DisableEventWaiting();
+    // An early wake by input leaves the deadline armed; drop it so it cannot cut the next wait short
+    if (idleWakerRunning)
+        ArmIdleWaker(-1.0);
+}
+
+// One simulation step; runs on the worker thread when pipelined and touches no GPU state
+void SimulateFrame(const InputFrame *input, float delta)
+{
+    simInput = *input;
+    frameDelta = delta;
+
+    switch (currentState)
+    {
+    case GAME_STATE_TITLE:
+        UpdateTitleScreen();
+        break;
+    case GAME_STATE_EXPLORE:
+        UpdateExplore();
+        break;
+    case GAME_STATE_BATTLE:
+        UpdateBattle();
+        break;
+    case GAME_STATE_ENDING_GOOD:
+    case GAME_STATE_ENDING_BAD:
+    case GAME_STATE_ENDING_ESCAPE:
+        if (InputPressed(KEY_ENTER))
+        {
+            InitGame();
+            ReflectInput("reinicio");
+        }
+        break;
+    }
+}
+
+void CaptureSnapshot(FrameSnapshot *frame)
+{
+    frame->state = currentState;
+    frame->stage = currentStage;
+    frame->player = player;
+    frame->boss = boss;
+    memcpy(frame->inventory, inventory, InventorySlotCount() * sizeof(ItemType));
+    memcpy(frame->itemUsed, itemUsed, InventorySlotCount() * sizeof(bool));
+    frame->inventoryCount = inventoryCount;
+    frame->inventoryScroll = inventoryScroll;
+    frame->inventoryVersion = inventoryVersion;
+    frame->selectedItemIndex = selectedItemIndex;
+    snprintf(frame->battleMessage, sizeof(frame->battleMessage), "%s", battleMessage ? battleMessage : "");
+    frame->lastItemCollected = lastItemCollected;
+    frame->itemMessageTimer = itemMessageTimer;
+
+    frame->playerIsAttacking = playerIsAttacking;
+    frame->playerAttackTimer = playerAttackTimer;
+    frame->playerAttackFrame = playerAttackFrame;
+    frame->playerHurtTimer = playerHurtTimer;
+    frame->bossIsAttacking = bossIsAttacking;
+    frame->bossAttackTimer = bossAttackTimer;
+    frame->bossAttackFrame = bossAttackFrame;
+    frame->bossHurtTimer = bossHurtTimer;
+
+    frame->explorePlayer = (Vector2){explorePlayerX, explorePlayerY};
+    frame->camera = exploreCamera;
+    frame->gemsCollected = gemsCollected;
+    frame->exploreNotice = (exploreNoticeTimer > 0) ? exploreNotice : NULL;
+    frame->npcLine = NULL;
+    if (nearbyNpc != -1)
+    {
+        frame->npcLine = npcLines[worldEntities[nearbyNpc].line];
+        frame->npcRect = worldEntities[nearbyNpc].rect;
+    }
+
+    frame->visibleCount = 0;
+    if (currentState == GAME_STATE_EXPLORE)
+    {
+        int count = SpatialHashQuery(&worldHash, worldEntities, CameraViewRect(exploreCamera), queryResults, MAX_QUERY_RESULTS);
+        for (int i = 0; i < count && frame->visibleCount < MAX_VISIBLE_ENTITIES; i++)
+        {
+            const WorldEntity *entity = &worldEntities[queryResults[i]];
+            frame->visible[frame->visibleCount++] = (VisibleEntity){entity->type, entity->rect, entity->choice};
+        }
+    }
+
+    memcpy(frame->tileEdits, pendingTileEdits, pendingTileEditCount * sizeof(TileEdit));
+    frame->tileEditCount = pendingTileEditCount;
+    pendingTileEditCount = 0;
+
+    frame->titlePhase = (int)(simInput.time * 2) % 2;
+    frame->dirty = frameDirty || StateNeedsRedraw() || currentState != lastCapturedState;
+    frame->wakeDelay = IdleWakeDelay();
+    frame->inputTime = simInput.time;
+    frame->reflectedAction = reflectedAction;
+    frame->reflectedInputTime = simInput.time;
+    frame->reflectedSequence = simInput.sequence;
+    reflectedAction = NULL;
+    frameDirty = false;
+    lastTitlePhase = frame->titlePhase;
+    lastCapturedState = currentState;
+}
+
+void ApplyTileEdits(const FrameSnapshot *frame)
+{
+    for (int i = 0; i < frame->tileEditCount; i++)
+        SetMapTile(&tileMap, frame->tileEdits[i].x, frame->tileEdits[i].y, frame->tileEdits[i].tile);
+}
+
+void RecordInputLatency(const FrameSnapshot *frame, double presentTime)
+{
+    if (!frame->reflectedAction)
+        return;
+
+    double ms = (presentTime - frame->reflectedInputTime) * 1000.0;
+    int bucket = (int)(ms / LATENCY_BUCKET_MS);
+    latencyHistogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    latencySamples++;
+    latencyLastMs = ms;
+    latencyMaxMs = fmax(latencyMaxMs, ms);
+
+    if (!latencyLog)
+    {
+        latencyLog = fopen(LATENCY_LOG_FILE, "w");
+        if (latencyLog)
+            fprintf(latencyLog, "sequencia,acao,entrada_s,tela_s,latencia_ms\n");
+    }
+    if (latencyLog)
+        fprintf(latencyLog, "%u,%s,%.6f,%.6f,%.3f\n", frame->reflectedSequence, frame->reflectedAction,
+                frame->reflectedInputTime, presentTime, ms);
+}
+
+// Upper edge of the bucket holding the given fraction of samples
+double LatencyPercentile(double fraction)
+{
+    int target = (int)ceil(latencySamples * fraction);
+    int seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += latencyHistogram[i];
+        if (seen >= target)
+            return (i + 1) * LATENCY_BUCKET_MS;
+    }
+    return LATENCY_BUCKETS * LATENCY_BUCKET_MS;
+}
+
+void DrawLatencyOverlay(void)
+{
+    int x = SCREEN_WIDTH - 270;
+    int y = SCREEN_HEIGHT / 2 - 80;
+    int barWidth = 250 / LATENCY_BUCKETS;
+    DrawRectangle(x - 5, y - 5, 265, 170, (Color){0, 0, 0, 180});
+    DrawGameText(TextFormat("Entrada -> tela: %d amostras", latencySamples), x, y, 12, YELLOW);
+    y += 18;
+    if (latencySamples > 0)
+        DrawGameText(TextFormat("última %.1f  p50 %.0f  p95 %.0f  max %.1f ms", latencyLastMs, LatencyPercentile(0.5),
+                                LatencyPercentile(0.95), latencyMaxMs),
+                     x, y, 12, WHITE);
+    y += 18;
+
+    int peak = 1;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        peak = latencyHistogram[i] > peak ? latencyHistogram[i] : peak;
+    int baseY = y + 100;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        int h = latencyHistogram[i] * 100 / peak;
+        DrawRectangle(x + i * barWidth, baseY - h, barWidth - 1, h, (i * LATENCY_BUCKET_MS < 34) ? GREEN : ORANGE);
+    }
+    DrawGameText("0", x, baseY + 4, 10, LIGHTGRAY);
+    DrawGameText(TextFormat("%d+ ms", (LATENCY_BUCKETS - 1) * LATENCY_BUCKET_MS), x + 200, baseY + 4, 10, LIGHTGRAY);
+}
+
+void SaveLatencyReport(void)
+{
+    if (latencySamples > 0)
+        TraceLog(LOG_INFO, "LATENCY: %d amostras, p50 %.0f ms, p95 %.0f ms, p99 %.0f ms, max %.1f ms (%s)", latencySamples,
+                 LatencyPercentile(0.5), LatencyPercentile(0.95), LatencyPercentile(0.99), latencyMaxMs, LATENCY_LOG_FILE);
+    if (!latencyLog)
+        return;
+
+    fprintf(latencyLog, "\n# histograma\nfaixa_ms,amostras\n");
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        fprintf(latencyLog, "%d-%d,%d\n", i * LATENCY_BUCKET_MS, (i + 1) * LATENCY_BUCKET_MS, latencyHistogram[i]);
+    fclose(latencyLog);
+    latencyLog = NULL;
+}
+
+void *SimulationThread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&simMutex);
+    while (true)
+    {
+        while (!simJobPending && !simQuit)
+            pthread_cond_wait(&simCond, &simMutex);
+        if (simQuit)
+            break;
+
+        InputFrame input = simJobInput;
+        float delta = simJobDelta;
+        FrameSnapshot *target = &snapshots[simJobTarget];
+        simJobPending = false;
+        pthread_mutex_unlock(&simMutex);
+
+        double start = GetTime();
+        SimulateFrame(&input, delta);
+        CaptureSnapshot(target);
+        target->simSeconds = GetTime() - start;
+
+        pthread_mutex_lock(&simMutex);
+        simJobDone = true;
+        pthread_cond_broadcast(&simCond);
+    }
+    pthread_mutex_unlock(&simMutex);
+    return NULL;
+}
+
+void WaitSimJob(void)
+{
+    pthread_mutex_lock(&simMutex);
+    while (!simJobDone)
+        pthread_cond_wait(&simCond, &simMutex);
+    pthread_mutex_unlock(&simMutex);
+}
+
+void PostSimJob(const InputFrame *input, float delta, int target)
+{
+    pthread_mutex_lock(&simMutex);
+    simJobInput = *input;
+    simJobDelta = delta;
+    simJobTarget = target;
+    simJobDone = false;
+    simJobPending = true;
+    pthread_cond_broadcast(&simCond);
+    pthread_mutex_unlock(&simMutex);
+}
+
+bool LoadCaptureGl(void)
+{
+    glGenBuffersFn = (GlGenBuffersProc)glfwGetProcAddress("glGenBuffers");
+    glDeleteBuffersFn = (GlDeleteBuffersProc)glfwGetProcAddress("glDeleteBuffers");
+    glBindBufferFn = (GlBindBufferProc)glfwGetProcAddress("glBindBuffer");
+    glBufferDataFn = (GlBufferDataProc)glfwGetProcAddress("glBufferData");
+    glReadPixelsFn = (GlReadPixelsProc)glfwGetProcAddress("glReadPixels");
+    glMapBufferFn = (GlMapBufferProc)glfwGetProcAddress("glMapBuffer");
+    glUnmapBufferFn = (GlUnmapBufferProc)glfwGetProcAddress("glUnmapBuffer");
+    glFenceSyncFn = (GlFenceSyncProc)glfwGetProcAddress("glFenceSync");
+    glClientWaitSyncFn = (GlClientWaitSyncProc)glfwGetProcAddress("glClientWaitSync");
+    glDeleteSyncFn = (GlDeleteSyncProc)glfwGetProcAddress("glDeleteSync");
+
+    return glGenBuffersFn && glDeleteBuffersFn && glBindBufferFn && glBufferDataFn && glReadPixelsFn && glMapBufferFn &&
+           glUnmapBufferFn && glFenceSyncFn && glClientWaitSyncFn && glDeleteSyncFn;
+}
+
+// Flips the bottom-up GL rows and forces opaque alpha, then writes one QOI file per frame
+void *CaptureEncoderThread(void *arg)
+{
+    (void)arg;
+    int rowBytes = captureWidth * 4;
+
+    pthread_mutex_lock(&captureMutex);
+    while (true)
+    {
+        while (captureQueueCount == 0 && !captureStopping)
+            pthread_cond_wait(&captureCond, &captureMutex);
+        if (captureQueueCount == 0)
+            break;
+
+        int index = captureQueue[captureQueueHead];
+        captureQueueHead = (captureQueueHead + 1) % CAPTURE_POOL_FRAMES;
+        captureQueueCount--;
+        pthread_mutex_unlock(&captureMutex);
+
+        unsigned char *pixels = capturePool[index];
+        for (int y = 0; y < captureHeight / 2; y++)
+        {
+            unsigned char *top = pixels + (size_t)y * rowBytes;
+            unsigned char *bottom = pixels + (size_t)(captureHeight - 1 - y) * rowBytes;
+            memcpy(captureScratchRow, top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, captureScratchRow, rowBytes);
+        }
+        for (size_t i = 3; i < (size_t)rowBytes * captureHeight; i += 4)
+            pixels[i] = 255;
+
+        char path[128];
+        snprintf(path, sizeof(path), "%s/quadro_%06ld.qoi", captureDir, capturePoolFrame[index]);
+        Image image = {pixels, captureWidth, captureHeight, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        bool written = ExportImage(image, path);
+
+        pthread_mutex_lock(&captureMutex);
+        if (written)
+            captureFramesWritten++;
+        else
+            captureFramesDropped++;
+        captureFreeList[captureFreeCount++] = index;
+    }
+    pthread_mutex_unlock(&captureMutex);
+    return NULL;
+}
+
+void ReleaseCaptureBuffers(void)
+{
+    long pboBytes = (long)captureWidth * captureHeight * 4;
+    for (int i = 0; i < CAPTURE_PBO_COUNT; i++)
+    {
+        if (captureFences[i])
+            glDeleteSyncFn(captureFences[i]);
+        captureFences[i] = NULL;
+        if (capturePbos[i])
+            TrackTextureBytes(MEM_TAG_CAPTURE, -pboBytes);
+    }
+    if (capturePbos[0])
+        glDeleteBuffersFn(CAPTURE_PBO_COUNT, capturePbos);
+    memset(capturePbos, 0, sizeof(capturePbos));
+
+    for (int i = 0; i < CAPTURE_POOL_FRAMES; i++)
+    {
+        TrackedFree(capturePool[i]);
+        capturePool[i] = NULL;
+    }
+    TrackedFree(captureScratchRow);
+    captureScratchRow = NULL;
+}
+
+void StartCapture(void)
+{
+    if (!LoadCaptureGl())
+    {
+        TraceLog(LOG_WARNING, "CAPTURE: driver sem pixel buffer objects ou fences, captura indisponivel");
+        return;
+    }
+
+    captureWidth = GetRenderWidth();
+    captureHeight = GetRenderHeight();
+    long frameBytes = (long)captureWidth * captureHeight * 4;
+
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", localtime(&now));
+    snprintf(captureDir, sizeof(captureDir), "%s/sessao_%s", CAPTURE_DIR, stamp);
+    MakeCaptureDir(CAPTURE_DIR);
+    MakeCaptureDir(captureDir);
+
+    glGenBuffersFn(CAPTURE_PBO_COUNT, capturePbos);
+    for (int i = 0; i < CAPTURE_PBO_COUNT; i++)
+    {
+        glBindBufferFn(GL_PIXEL_PACK_BUFFER, capturePbos[i]);
+        glBufferDataFn(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+        TrackTextureBytes(MEM_TAG_CAPTURE, frameBytes);
+        captureFences[i] = NULL;
+    }
+    glBindBufferFn(GL_PIXEL_PACK_BUFFER, 0);
+
+    // The whole pool is allocated up front so the game loop never allocates while recording
+    captureFreeCount = 0;
+    for (int i = 0; i < CAPTURE_POOL_FRAMES; i++)
+    {
+        capturePool[i] = TrackedAlloc(MEM_TAG_CAPTURE, frameBytes);
+        if (capturePool[i])
+            captureFreeList[captureFreeCount++] = i;
+    }
+    captureScratchRow = TrackedAlloc(MEM_TAG_CAPTURE, (size_t)captureWidth * 4);
+
+    captureNextPbo = 0;
+    captureQueueHead = 0;
+    captureQueueCount = 0;
+    captureStopping = false;
+    captureFramesWritten = 0;
+    captureFramesDropped = 0;
+    captureCostAverage = 0.0;
+
+    if (captureFreeCount == 0 || !captureScratchRow || pthread_create(&captureThread, NULL, CaptureEncoderThread, NULL) != 0)
+    {
+        TraceLog(LOG_WARNING, "CAPTURE: nao foi possivel iniciar a gravacao");
+        ReleaseCaptureBuffers();
+        return;
+    }
+
+    captureStartTime = GetTime();
+    captureActive = true;
+    TraceLog(LOG_INFO, "CAPTURE: gravando %dx%d em %s", captureWidth, captureHeight, captureDir);
+}
+
+// Hands a finished readback to the encoder; returns false while the GPU is still copying
+bool CollectCapture(int slot, bool wait)
+{
+    unsigned int status = glClientWaitSyncFn(captureFences[slot], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+
+    glDeleteSyncFn(captureFences[slot]);
+    captureFences[slot] = NULL;
+
+    pthread_mutex_lock(&captureMutex);
+    int index = (captureFreeCount > 0) ? captureFreeList[--captureFreeCount] : -1;
+    if (index < 0)
+        captureFramesDropped++;
+    pthread_mutex_unlock(&captureMutex);
+    if (index < 0)
+        return true;
+
+    glBindBufferFn(GL_PIXEL_PACK_BUFFER, capturePbos[slot]);
+    const void *mapped = glMapBufferFn(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (mapped)
+    {
+        memcpy(capturePool[index], mapped, (size_t)captureWidth * captureHeight * 4);
+        glUnmapBufferFn(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBufferFn(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_lock(&captureMutex);
+    if (mapped)
+    {
+        capturePoolFrame[index] = capturePboFrame[slot];
+        captureQueue[(captureQueueHead + captureQueueCount) % CAPTURE_POOL_FRAMES] = index;
+        captureQueueCount++;
+        pthread_cond_broadcast(&captureCond);
+    }
+    else
+    {
+        captureFramesDropped++;
+        captureFreeList[captureFreeCount++] = index;
+    }
+    pthread_mutex_unlock(&captureMutex);
+    return true;
+}
+
+// Called with the finished frame still in the back buffer; never blocks on the GPU or the encoder
+void CaptureFrame(long frameNumber)
+{
+    double start = GetTime();
+    rlDrawRenderBatchActive();
+
+    for (int i = 0; i < CAPTURE_PBO_COUNT; i++)
+    {
+        int slot = (captureNextPbo + i) % CAPTURE_PBO_COUNT;
+        if (captureFences[slot])
+            CollectCapture(slot, false);
+    }
+
+    int slot = captureNextPbo;
+    if (captureFences[slot])
+    {
+        captureFramesDropped++;
+    }
+    else
+    {
+        glBindBufferFn(GL_PIXEL_PACK_BUFFER, capturePbos[slot]);
+        glReadPixelsFn(0, 0, captureWidth, captureHeight, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindBufferFn(GL_PIXEL_PACK_BUFFER, 0);
+        captureFences[slot] = glFenceSyncFn(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        capturePboFrame[slot] = frameNumber;
+        captureNextPbo = (slot + 1) % CAPTURE_PBO_COUNT;
+    }
+
+    captureCostAverage = captureCostAverage * 0.9 + (GetTime() - start) * 0.1;
+}
+
+void StopCapture(void)
+{
+    if (!captureActive)
+        return;
+
+    for (int i = 0; i < CAPTURE_PBO_COUNT; i++)
+    {
+        int slot = (captureNextPbo + i) % CAPTURE_PBO_COUNT;
+        if (captureFences[slot])
+            CollectCapture(slot, true);
+    }
+
+    pthread_mutex_lock(&captureMutex);
+    captureStopping = true;
+    pthread_cond_broadcast(&captureCond);
+    pthread_mutex_unlock(&captureMutex);
+    pthread_join(captureThread, NULL);
+
+    TraceLog(LOG_INFO, "CAPTURE: %ld quadros gravados em %s, %ld descartados, %.1f fps de captura, +%.3f ms por quadro",
+             captureFramesWritten, captureDir, captureFramesDropped,
+             captureFramesWritten / fmax(GetTime() - captureStartTime, 0.001), captureCostAverage * 1000.0);
+    ReleaseCaptureBuffers();
+    captureActive = false;
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    bool startCapture = false;
+    if (argc > 1 && strcmp(argv[1], "--convert-assets") == 0)
+        return ConvertAssets();
+    if (argc > 1 && strcmp(argv[1], "--bench-spatial") == 0)
+        return BenchmarkSpatialHash();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--always-redraw") == 0)
+            idlePacing = false;
+        else if (strcmp(argv[i], "--serial") == 0)
+            pipelined = false;
+        else if (strcmp(argv[i], "--uncapped") == 0)
+            uncapped = true;
+        else if (strcmp(argv[i], "--capture") == 0)
+            startCapture = true;
+        else if (strcmp(argv[i], "--debug-inventory") == 0)
+            debugInventory = true;
+    }
+
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Raylib RPG de Turnos");
+
+    // Default framebuffer: front and back color buffers plus a 24/8 depth-stencil buffer
+    long framebufferBytes = 3L * SCREEN_WIDTH * SCREEN_HEIGHT * 4;
+    TrackTextureBytes(MEM_TAG_RENDERING, framebufferBytes);
+    Font defaultFont = GetFontDefault();
+    TrackTexture(MEM_TAG_TEXT, defaultFont.texture);
+    InitGameText();
+
     InitGame();
-    SetTargetFPS(60);
+    SetTargetFPS(uncapped ? 0 : 60);
+    if (startCapture)
+        StartCapture();
+
+    double lastTime = GetTime();
+    double lastDrawTime = 0.0;
+    double startTime = lastTime;
+    clock_t startCpu = clock();
+    bool wasFocused = IsWindowFocused();
+    int front = 0;
+
+    simInput.time = lastTime;
+    CaptureSnapshot(&snapshots[front]);
+    if (idlePacing)
+        StartIdleWaker();
+    if (pipelined && pthread_create(&simThread, NULL, SimulationThread, NULL) != 0)
+    {
+        TraceLog(LOG_WARNING, "PIPELINE: falha ao criar a thread de simulacao, usando modo serial");
+        pipelined = false;
+    }
 
     while (!WindowShouldClose())
     {
-        switch (currentState)
+        InputFrame input = PollInputFrame();
+        float delta = fminf((float)(input.time - lastTime), MAX_FRAME_DELTA);
+        lastTime = input.time;
+
+        bool forceDraw = IsKeyPressed(KEY_F3) || IsKeyPressed(KEY_F4) || IsKeyPressed(KEY_F5) || IsKeyPressed(KEY_F9);
+        if (IsKeyPressed(KEY_F3))
+            showMemoryOverlay = !showMemoryOverlay;
+        if (IsKeyPressed(KEY_F4))
+            useLegacyText = !useLegacyText;
+        if (IsKeyPressed(KEY_F5))
+            useLegacyHud = !useLegacyHud;
+        if (IsKeyPressed(KEY_F9))
         {
-        case GAME_STATE_TITLE:
-            UpdateTitleScreen();
-            break;
-        case GAME_STATE_EXPLORE:
-            UpdateExplore();
-            break;
-        case GAME_STATE_BATTLE:
-            UpdateBattle();
-            break;
-        case GAME_STATE_ENDING_GOOD:
-        case GAME_STATE_ENDING_BAD:
-        case GAME_STATE_ENDING_ESCAPE:
-            if (IsKeyPressed(KEY_ENTER))
-                InitGame();
-            break;
+            if (captureActive)
+                StopCapture();
+            else
+                StartCapture();
+        }
+
+        // Pipelined: draw the snapshot of frame N while the worker simulates N+1 into the other buffer
+        if (pipelined)
+        {
+            WaitSimJob();
+            front = simJobTarget;
+            PostSimJob(&input, delta, 1 - front);
+        }
+        else
+        {
+            double start = GetTime();
+            SimulateFrame(&input, delta);
+            CaptureSnapshot(&snapshots[front]);
+            snapshots[front].simSeconds = GetTime() - start;
+        }
+        const FrameSnapshot *frame = &snapshots[front];
+        ApplyTileEdits(frame);
+        simTimeAverage = simTimeAverage * 0.9 + frame->simSeconds * 0.1;
+
+        if (showMemoryOverlay || IsWindowResized() || IsWindowFocused() != wasFocused ||
+            input.time - lastDrawTime >= IDLE_REFRESH_SECONDS)
+            forceDraw = true;
+
+        if (idlePacing && !frame->dirty && !forceDraw)
+        {
+            framesSkipped++;
+            cpuTimeSaved += drawnFrameCpuAverage;
+            // A fresh press is still in flight to the worker and will dirty the next snapshot, so skip the
+            // wait; held keys may change nothing (walking into a wall), so they only bound the wait
+            if (pipelined && input.pressed != 0)
+                PollInputEvents();
+            else if (pipelined && input.down != 0)
+                IdleWait(frame->wakeDelay < 0 ? IDLE_POLL_INTERVAL : frame->wakeDelay);
+            else
+                IdleWait(frame->wakeDelay);
+            continue;
         }
 
+        clock_t frameCpu = clock();
+        double drawStart = GetTime();
+        wasFocused = IsWindowFocused();
+        lastDrawTime = input.time;
+
         BeginDrawing();
-        switch (currentState)
+        switch (frame->state)
         {
         case GAME_STATE_TITLE:
-            DrawTitleScreen();
+            DrawTitleScreen(frame);
             break;
         case GAME_STATE_EXPLORE:
-            DrawExplore();
+            DrawExplore(frame);
             break;
         case GAME_STATE_BATTLE:
-            DrawBattle();
+            DrawBattle(frame);
             break;
         case GAME_STATE_ENDING_GOOD:
             DrawEnding(true);
@@ -856,30 +3957,70 @@ int main(void)
             DrawEscapeEnding();
             break;
         }
+        FlushGameText();
+        if (showMemoryOverlay)
+        {
+            DrawMemoryOverlay();
+            DrawLatencyOverlay();
+        }
+        EndGameTextFrame();
+        if (captureActive)
+        {
+            CaptureFrame(framesDrawn);
+            DrawCircle(SCREEN_WIDTH - 20, 20, 8, RED);
+        }
+        double drawSeconds = GetTime() - drawStart;
         EndDrawing();
+        // Returning from the buffer swap stands in for the photons; with a frame cap this includes its sleep
+        double presentTime = GetTime();
+        RecordInputLatency(frame, presentTime);
+
+        framesDrawn++;
+        drawTimeAverage = drawTimeAverage * 0.9 + drawSeconds * 0.1;
+        latencyAverage = latencyAverage * 0.9 + (presentTime - frame->inputTime) * 0.1;
+        drawnFrameCpuAverage = drawnFrameCpuAverage * 0.9 + (double)(clock() - frameCpu) / CLOCKS_PER_SEC * 0.1;
     }
 
-    if (playerTexture.id)
-        UnloadTexture(playerTexture);
-    if (bossTexture.id)
-        UnloadTexture(bossTexture);
-    if (titleBackgroundTexture.id)
-        UnloadTexture(titleBackgroundTexture);
-    if (battleBackgroundTexture.id)
-        UnloadTexture(battleBackgroundTexture);
-    if (bossAttackTexture.id)
-        UnloadTexture(bossAttackTexture);
-    if (playerAttackTexture.id)
-        UnloadTexture(playerAttackTexture);
-
-    if (bgStage1.id)
-        UnloadTexture(bgStage1);
-    if (bgStage2.id)
-        UnloadTexture(bgStage2);
-    if (bgStage3.id)
-        UnloadTexture(bgStage3);
-    if (bgStage4.id)
-        UnloadTexture(bgStage4);
+    if (pipelined)
+    {
+        WaitSimJob();
+        pthread_mutex_lock(&simMutex);
+        simQuit = true;
+        pthread_cond_broadcast(&simCond);
+        pthread_mutex_unlock(&simMutex);
+        pthread_join(simThread, NULL);
+    }
+    StopIdleWaker();
+
+    double wallTime = GetTime() - startTime;
+    double cpuTime = (double)(clock() - startCpu) / CLOCKS_PER_SEC;
+    TraceLog(LOG_INFO, "PACING: %ld quadros desenhados, %ld pulados, ~%.2f s de CPU poupados, CPU %.1f%% de um nucleo",
+             framesDrawn, framesSkipped, cpuTimeSaved, wallTime > 0 ? 100.0 * cpuTime / wallTime : 0.0);
+    TraceLog(LOG_INFO, "PIPELINE: modo %s, simulacao %.3f ms, desenho %.3f ms, entrada ate a tela %.2f ms, %.1f fps",
+             pipelined ? "paralelo" : "serial", simTimeAverage * 1000.0, drawTimeAverage * 1000.0, latencyAverage * 1000.0,
+             wallTime > 0 ? framesDrawn / wallTime : 0.0);
+
+    // Written while everything is still loaded so the current figures describe the running game
+    SaveMemoryReport("memory_report.json");
+    SaveLatencyReport();
+
+    Texture2D *gameTextures[] = {
+        &playerTexture, &bossTexture, &titleBackgroundTexture, &battleBackgroundTexture,
+        &playerAttackTexture, &bossAttackTexture, &playerHitTexture, &bossHitTexture,
+        &escapeEndingBackgroud, &wonEndingBackgroud, &loseEndingBackgroud,
+        &bgStage1, &bgStage2, &bgStage3, &bgStage4, &tilesetTexture};
+    for (int i = 0; i < (int)(sizeof(gameTextures) / sizeof(gameTextures[0])); i++)
+        UnloadTrackedTexture(MEM_TAG_ASSETS, gameTextures[i]);
+
+    FreeSpatialHash(&worldHash);
+    TrackedFree(worldEntities);
+    UnloadTileMap(&tileMap);
+    StopCapture();
+    UnloadGameText();
+    if (defaultFont.texture.id != 0)
+        TrackTextureBytes(MEM_TAG_TEXT, -TextureByteSize(defaultFont.texture));
+    TrackTextureBytes(MEM_TAG_RENDERING, -framebufferBytes);
+    CheckMemoryLeaks();
 
     CloseWindow();
     return 0;